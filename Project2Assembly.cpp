@@ -4,293 +4,2860 @@
 #include <string>
 #include <sstream>
 #include <cmath>
+#include <climits>
 #include <iomanip>
+#include <chrono>
+#include <thread>
+#include <map>
+#include <memory>
+#include "accessProfile.h"
+#include "cacheLevel.h"
+#include "checkpoint.h"
+#include "missClassifier.h"
+#include "missStream.h"
+#include "prefetcher.h"
+#include "spscRing.h"
+#include "stackDistance.h"
+#include "threadPool.h"
+#include "traceReader.h"
+#include "traceWriter.h"
+#include "victimCache.h"
 
 using namespace std;
 
-// Cache Line Structure
-struct CacheLine {
-    bool VB = false; // Valid bit
-    int tag = -1; // Cache tag
-};
-
 // Memory Inputs
 int memoryBits; // Memory address bits
 int memAT; // Memory access time
 
 // Cache Inputs
 int numLevels_data, numLevels_instr; // Number of cache levels for data and instruction
-vector<int> cacheSizes_data, cacheSizes_instr; // Cache sizes for data and instruction
+vector<long long> cacheSizes_data, cacheSizes_instr; // Cache sizes for data and instruction
 vector<int> cacheLineSizes_data, cacheLineSizes_instr; // Cache line sizes for data and instruction
 vector<int> cacheATs_data, cacheATs_instr; // Cache access times for data and instruction
+vector<int> cacheWays_data, cacheWays_instr; // Cache associativities for data and instruction
+vector<ReplacementPolicy> cachePolicies_data, cachePolicies_instr; // Replacement policies for data and instruction
+vector<WritePolicy> cacheWritePolicies_data; // Write policies of the data cache, the instruction side only reads
+
+vector<uint64_t> dataMemAdds; // Sweep trace addresses
+vector<bool> dataWrites; // Write flags of the addresses, empty for read-only traces
+
+const int WRITE_BYTES = 4; // Data written by one store, a 32-bit word
+const int SPARSE_DUMP_FRACTION = 8; // A sparse level's dump lists only its used sets when under this part of them
+
+// How much the simulation prints: the summary only, per-level results, or the full per-access trace
+enum Verbosity {
+    VERBOSITY_SUMMARY,
+    VERBOSITY_LEVELS,
+    VERBOSITY_TRACE
+};
+Verbosity verbosity = VERBOSITY_SUMMARY;
+TraceWriter traceOut; // Buffered output of the per-access trace
+
+// Trace files, and whether they are streamed in bounded chunks instead of loaded up front
+string instructionFile, dataFile;
+bool streamMode = false;
+bool stackDistanceMode = false; // Sweep level 1 capacities with stack distances instead of simulating
+string sweepFile; // Hierarchies to run against one trace in parallel, instead of the interactive ones
+unsigned workerThreads = thread::hardware_concurrency(); // Threads of --sweep and --schedule sets
+
+// Binary traces carry the stream type and address width they were captured with
+void checkTraceHeader(const string& filePath, const TraceHeader& header, TraceType type) {
+    if (header.type != type) {
+        cerr << "Warning: " << filePath << " holds a " << traceTypeName(header.type)
+            << " trace but is used as the " << traceTypeName(type) << " trace" << endl;
+    }
+    if (header.addressBits > memoryBits) {
+        cerr << "Warning: " << filePath << " was captured with " << static_cast<int>(header.addressBits)
+            << "-bit addresses, wider than the " << memoryBits << "-bit memory" << endl;
+    }
+}
+
+// Addresses must lie in the memory: its width sizes every level's tags
+void checkAddresses(const string& filePath, const vector<uint64_t>& addresses, size_t first) {
+    uint64_t end = 1ULL << memoryBits;
+    for (size_t i = 0; i < addresses.size(); i++) {
+        if (addresses[i] >= end) {
+            cerr << "Error reading file: " << filePath << " (address " << addresses[i] << " at access " << first + i + 1
+                << " is beyond the " << memoryBits << "-bit memory)" << endl;
+            exit(1);
+        }
+    }
+}
+
+// Function to read memory addresses from a file
+void readFile(const string& filePath, vector<uint64_t>& memAdds, vector<bool>& writes, TraceType type) {
+    ParseStats stats;
+    string error;
+    if (!loadTrace(filePath, memAdds, writes, stats, error)) {
+        cerr << "Error reading file: " << filePath << " (" << error << ")" << endl;
+        exit(1);
+    }
+    checkAddresses(filePath, memAdds, 0);
+    if (stats.binary) {
+        checkTraceHeader(filePath, stats.header, type);
+    }
+    double megabytes = stats.bytes / (1024.0 * 1024.0);
+    cout << "Loaded " << stats.addresses << " addresses from " << filePath
+        << " (" << fixed << setprecision(2) << megabytes << " MB in " << stats.seconds * 1000 << " ms, "
+        << (stats.seconds > 0 ? megabytes / stats.seconds : 0) << " MB/s)" << endl;
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
+}
+
+
+// Calls visit(i, address, write) for accesses first up to (not including) last of a trace, or up to its
+// end, either from the loaded addresses or, in streaming mode, chunk by chunk straight from the file.
+// Returns the position it stopped at: last, or the number of accesses.
+template <typename Visit>
+size_t forEachAddressIn(const vector<uint64_t>& memAdds, const vector<bool>& writes, const string& filePath,
+                        TraceType type, size_t first, size_t last, Visit visit) {
+    if (!streamMode) {
+        last = min(last, memAdds.size());
+        for (size_t i = first; i < last; i++) {
+            visit(i, memAdds[i], !writes.empty() && writes[i]);
+        }
+        return max(first, last);
+    }
+
+    TraceStream stream;
+    string error;
+    if (!stream.open(filePath, error)) {
+        cerr << "Error reading file: " << filePath << " (" << error << ")" << endl;
+        exit(1);
+    }
+    if (stream.isBinary()) {
+        checkTraceHeader(filePath, stream.header(), type);
+    }
+    vector<uint64_t> chunk;
+    vector<bool> chunkWrites;
+    size_t i = 0;
+    while (i < last && stream.next(chunk, chunkWrites)) {
+        checkAddresses(filePath, chunk, i);
+        for (size_t j = 0; j < chunk.size() && i < last; j++, i++) {
+            if (i >= first) {
+                visit(i, chunk[j], !chunkWrites.empty() && chunkWrites[j]);
+            }
+        }
+    }
+    if (stream.failed()) {
+        cerr << "Error reading file: " << filePath << " (" << stream.error() << ")" << endl;
+        exit(1);
+    }
+    return i;
+}
+
+// Calls visit(i, address, write) for every access of a trace. Returns the number of accesses.
+template <typename Visit>
+size_t forEachAddress(const vector<uint64_t>& memAdds, const vector<bool>& writes, const string& filePath,
+                      TraceType type, Visit visit) {
+    return forEachAddressIn(memAdds, writes, filePath, type, 0, SIZE_MAX, visit);
+}
+
+// "So far" block of the trace, written after every level an access visits
+void traceProgress(size_t i, int level, const vector<long long>& hits, const vector<long long>& misses) {
+    traceOut.text("-------------------------------------------------------------------").newline();
+    traceOut.text("Number of accesses so far: ").number(i).newline();
+    traceOut.text("Level ").number(level + 1).text(":").newline();
+    traceOut.text("Number of hits so far: ").number(hits[level]).newline();
+    traceOut.text("Number of misses so far: ").number(misses[level]).newline();
+    traceOut.text("-------------------------------------------------------------------").newline();
+}
+
+// Header row of the per-access trace
+void printTraceHeader() {
+    cout << left << setw(8) << "Access"
+        << setw(12) << "Address"
+        << setw(8) << "Index"
+        << setw(8) << "Tag"
+        << setw(6) << "VB"
+        << setw(8) << "CTag"
+        << setw(10) << "Result"
+        << setw(8) << "Level"
+        << setw(12) << "Type" << endl;
+}
+
+// AMAT of a whole hierarchy: every access pays level 1, every miss of a level pays the next level or memory,
+// and extraCost adds the cycles per access spent on writes sent down and waiting for late prefetches
+float hierarchyAMAT(size_t accesses, const vector<long long>& misses, const vector<int>& cacheATs, float extraCost) {
+    float amat = 0;
+    float reaching = 1; // Fraction of accesses that reach the current level
+    for (size_t level = 0; level < misses.size(); level++) {
+        amat += reaching * cacheATs[level];
+        reaching = accesses > 0 ? static_cast<float>(misses[level]) / accesses : 0;
+    }
+    return amat + reaching * memAT + extraCost;
+}
+
+// One summary row per cache: accesses, hits in any level, misses that went to memory, and the AMAT of the
+// whole hierarchy, followed by an optional description of the hierarchy
+void printSummaryRow(const string& name, size_t accesses, const vector<long long>& hits, const vector<long long>& misses,
+                     const vector<int>& cacheATs, float extraCost, const string& hierarchy = "") {
+    long long totalHits = 0;
+    for (long long levelHits : hits) {
+        totalHits += levelHits;
+    }
+    float amat = hierarchyAMAT(accesses, misses, cacheATs, extraCost);
+    long long memoryAccesses = misses.empty() ? static_cast<long long>(accesses) : misses.back();
+    cout << setw(14) << name
+        << setw(12) << accesses
+        << setw(10) << totalHits
+        << setw(10) << memoryAccesses
+        << setw(12) << (accesses > 0 ? static_cast<float>(totalHits) / accesses : 0);
+    if (hierarchy.empty()) {
+        cout << amat << endl;
+    }
+    else {
+        cout << setw(14) << amat << hierarchy << endl;
+    }
+}
+
+// Final VB/tag state of every line of one level, and the dirty bits when the trace had writes, written
+// through the trace buffer. A sparse level that a short trace barely used lists only the sets holding
+// a line, so the dump scales with the trace rather than the configured size.
+void printCacheContents(const string& typeName, int level, const CacheLevel& cache, bool showDirty) {
+    traceOut.text(typeName.c_str()).text(" Cache Level ").number(level + 1).text(":").newline();
+    traceOut.field("Index", 8);
+    if (cache.ways > 1) {
+        traceOut.field("Way", 6);
+    }
+    traceOut.field("VB", 12).field("Tag", 8);
+    if (showDirty) {
+        traceOut.field("Dirty", 8);
+    }
+    traceOut.newline();
+    vector<int> usedSets;
+    bool listUsed = false;
+    if (cache.sparse()) {
+        for (int set = 0; set < cache.numSets; set++) {
+            if (cache.holdsLines(set)) {
+                usedSets.push_back(set);
+            }
+        }
+        listUsed = usedSets.size() < static_cast<size_t>(cache.numSets) / SPARSE_DUMP_FRACTION;
+    }
+    int listed = listUsed ? static_cast<int>(usedSets.size()) : cache.numSets;
+    for (int i = 0; i < listed; i++) {
+        int set = listUsed ? usedSets[i] : i;
+        for (int way = 0; way < cache.ways; way++) {
+            traceOut.field(set, 8);
+            if (cache.ways > 1) {
+                traceOut.field(way, 6);
+            }
+            traceOut.field(cache.isValid(set, way), 12).field(cache.tagOf(set, way), 8);
+            if (showDirty) {
+                traceOut.field(cache.isDirty(set, way), 8);
+            }
+            traceOut.newline();
+        }
+    }
+    if (listUsed) {
+        traceOut.text("(").number(cache.numSets - listed).text(" of ").number(cache.numSets)
+            .text(" sets hold no lines and are not listed)").newline();
+    }
+}
+
+// JSON string literal of text
+string jsonString(const string& text) {
+    string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+// True when path names a JSON file, otherwise CSV is written
+bool isJsonPath(const string& path) {
+    return path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+}
+
+const size_t PIPELINE_RING_SIZE = 1 << 14; // Messages in flight between two stages
+
+// Where a stage sends what leaves its level: the next stage's ring, none for the last level, and the
+// level's miss stream while it is being stored
+struct StageOutput {
+    SpscRing<PipelineMessage>* ring = nullptr;
+    MissStreamWriter* record = nullptr;
+
+    void push(const PipelineMessage& message) {
+        ring->push(message);
+        if (record != nullptr) {
+            record->append(message);
+        }
+    }
+};
+
+// Statistical sampling from --sample: periodic windows of the trace are measured (SMARTS-style) while the
+// accesses in between only warm the caches, or only a subset of the sets is simulated at all
+enum SampleKind {
+    SAMPLE_NONE,
+    SAMPLE_PERIODIC,
+    SAMPLE_SETS
+};
+
+struct SampleOption {
+    SampleKind kind = SAMPLE_NONE;
+    uint64_t window = 0, period = 0; // Periodic: the first window accesses of every period are measured
+    uint64_t warmup = 0; // Periodic: accesses simulated ahead of each window, 0 to simulate every access
+    unsigned ratio = 0; // Sets: one group of sets in ratio is simulated
+};
+
+// What the accesses of one sample unit (a window, or a group of sets) did
+struct SampleUnit {
+    uint64_t accesses = 0;
+    uint64_t hits = 0; // In any level
+    double cycles = 0; // Access time, with the writes sent down, as the AMAT counts it
+};
+
+const double CONFIDENCE_Z = 1.96; // Normal quantile of two-sided 95% confidence intervals
+// Student-t quantiles of two-sided 95% confidence intervals, for 1 to 30 degrees of freedom
+const double CONFIDENCE_T[30] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+
+// Student-t quantile for an interval estimated with the given degrees of freedom (at least 1); past the
+// table, the first terms of its expansion around the normal quantile
+double confidenceQuantile(size_t degrees) {
+    if (degrees <= 30) {
+        return CONFIDENCE_T[degrees - 1];
+    }
+    double z = CONFIDENCE_Z, d = static_cast<double>(degrees);
+    return z + (z * z * z + z) / (4 * d) + (5 * pow(z, 5) + 16 * z * z * z + 3 * z) / (96 * d * d);
+}
+
+string missCacheDir; // Where miss streams are stored for later runs, empty unless --miss-cache is given
+map<string, string> traceHashes; // Hex content hash per trace file, each file hashed once per run
+
+// Content hash of a trace file, for keying the miss streams of its runs
+const string& traceHash(const string& filePath) {
+    auto known = traceHashes.find(filePath);
+    if (known != traceHashes.end()) {
+        return known->second;
+    }
+    uint64_t hash;
+    string error;
+    if (!hashFile(filePath, hash, error)) {
+        cerr << "Error reading file: " << filePath << " (" << error << ")" << endl;
+        exit(1);
+    }
+    ostringstream hex;
+    hex << std::hex << setw(16) << setfill('0') << hash;
+    return traceHashes[filePath] = hex.str();
+}
+
+
+// One cache hierarchy, the data or the instruction side or a hierarchy of a config file: its levels, the
+// trace it reads, and its results. Hierarchies share no state, so they can run one after the other, on
+// separate threads, or interleaved.
+struct CacheHierarchy {
+    string typeName; // "Data", "Instruction" or a config file's name, as shown in the trace and the tables
+    TraceType type;
+    const vector<uint64_t>& memAdds; // Loaded addresses, unused in streaming mode
+    const vector<bool>& writes; // Their write flags
+    string filePath;
+    vector<CacheLevel> caches;
+    vector<int> cacheATs;
+    InclusionPolicy inclusion;
+
+    size_t accesses = 0;
+    size_t position = 0; // Trace accesses simulated, including those before a restored checkpoint
+    size_t stopAt = SIZE_MAX; // Trace position the run stops at
+    vector<long long> hits, misses; // Per level
+    vector<float> hitRatios, missRatios, AMATs; // Per level, set by finish()
+
+    // Write and traffic accounting, per level: dirty lines evicted, writes passed on by write-through,
+    // and bytes exchanged with the level below (line fills, writebacks, writes and moved victims)
+    vector<long long> writebacks, writeThroughs, trafficBytes;
+    long long memoryReadBytes = 0, memoryWriteBytes = 0;
+
+    vector<int> probeIndex; // Index and tag of the current access in each level it reached
+    vector<int64_t> probeTag;
+
+    // Prefetchers and victim or miss caches, one per level (kind NONE where there is none), and the clock
+    // prefetch timing runs on: each demand access advances it by the access times it paid
+    vector<Prefetcher> prefetchers;
+    vector<VictimCache> victimCaches;
+    bool assisted = false; // Some level has a prefetcher or a victim cache
+    uint64_t clock = 0;
+    vector<int64_t> candidates; // Lines the prefetchers asked for on the current access
+
+    vector<MissClassifier> classifiers; // Per level once classifyMisses() is called, empty otherwise
+    AccessProfile profile; // Reuse distances and per-set pressure, once profileAccesses() is called
+    bool profiling = false;
+
+    SampleOption sampling; // Kind SAMPLE_NONE unless sample() is called
+    vector<SampleUnit> units; // Measured windows or set groups of a sampled run
+    size_t traceAccesses = 0; // Accesses of the whole trace in a sampled run; accesses holds those measured
+
+    CacheHierarchy(const string& typeName, TraceType type, const vector<uint64_t>& memAdds, const vector<bool>& writes,
+                   const string& filePath, const vector<CacheLevel>& caches, const vector<int>& cacheATs,
+                   InclusionPolicy inclusion = INCLUSION_NINE)
+        : typeName(typeName), type(type), memAdds(memAdds), writes(writes), filePath(filePath), caches(caches),
+          cacheATs(cacheATs), inclusion(inclusion), hits(caches.size(), 0), misses(caches.size(), 0),
+          writebacks(caches.size(), 0), writeThroughs(caches.size(), 0), trafficBytes(caches.size(), 0),
+          probeIndex(caches.size(), 0), probeTag(caches.size(), 0), prefetchers(caches.size()),
+          victimCaches(caches.size()) {
+    }
+
+    void attachPrefetcher(int level, PrefetcherKind kind, int degree) {
+        prefetchers[level] = Prefetcher(kind, degree, caches[level].numLines);
+        assisted = assisted || kind != PREFETCH_NONE;
+    }
+
+    void attachVictimCache(int level, VictimCacheKind kind, int entries) {
+        victimCaches[level] = VictimCache(kind, entries);
+        assisted = assisted || kind != VICTIM_NONE;
+    }
+
+    // Splits every level's misses into compulsory, capacity and conflict misses
+    void classifyMisses() {
+        classifiers.clear();
+        for (const CacheLevel& cache : caches) {
+            classifiers.push_back(MissClassifier(cache.numLines));
+        }
+    }
+
+    // Records the reuse distances of the trace and the accesses and misses of every set
+    void profileAccesses() {
+        vector<int> numSets;
+        for (const CacheLevel& cache : caches) {
+            numSets.push_back(cache.numSets);
+        }
+        profile = AccessProfile(caches.empty() ? 1 : caches[0].lineSize, numSets);
+        profiling = true;
+    }
+
+    // Measures only part of the trace or of the sets, and estimates the rest
+    void sample(const SampleOption& option) {
+        sampling = option;
+    }
+
+    // Classifiers or the profile need the instrumented access()
+    bool instrumented() const {
+        return !classifiers.empty() || profiling;
+    }
+
+    // Simulates access number i through the levels. PowerOfTwo selects the shift/mask address split for
+    // every level at compile time, and Trace compiles the per-access trace in or out so quiet runs never
+    // touch it. Assist does the same for the prefetchers, victim caches and the prefetch clock, and
+    // Instrument for the miss classifiers and the access profile.
+    template <bool PowerOfTwo, bool Trace, bool Assist, bool Instrument>
+    void access(size_t i, uint64_t address, bool write) {
+        int numLevels = caches.size();
+        int hitLevel = numLevels, hitWay = -1; // Memory unless a level hits
+        bool victimHit = false, victimDirty = false; // The line came from the hit level's victim or miss cache
+        bool streamHit = false; // The line came from the hit level's stream buffer
+        bool prefetchedHit = false; // The hit used a prefetched line
+        uint64_t stall = 0; // Cycles spent waiting for late prefetches
+        if (Instrument && profiling) {
+            profile.access(address);
+        }
+        for (int level = 0; level < numLevels; level++) {
+            int& index = probeIndex[level];
+            int64_t& tag = probeTag[level];
+            caches[level].locate<PowerOfTwo>(address, index, tag);
+            int way = caches[level].find(index, tag);
+            if (Assist && way < 0 && victimCaches[level].kind != VICTIM_NONE) {
+                victimHit = victimCaches[level].take(address / caches[level].lineSize, victimDirty);
+            }
+            if (Assist && way < 0 && !victimHit && prefetchers[level].kind == PREFETCH_STREAM) {
+                streamHit = prefetchers[level].takeHead(address / caches[level].lineSize, clock, stall);
+            }
+
+            // Trace the access, showing the matching line on a hit and the line a fill would replace on a miss
+            if (Trace) {
+                int shown = way >= 0 ? way : caches[level].victim(index);
+                traceOut.field(i + 1, 8)
+                    .field(address, 12)
+                    .field(index, 8)
+                    .field(tag, 8)
+                    .field(caches[level].isValid(index, shown), 6)
+                    .field(caches[level].tagOf(index, shown), 8);
+            }
+
+            if (Instrument) {
+                bool hit = way >= 0 || victimHit || streamHit;
+                if (!classifiers.empty()) {
+                    classifiers[level].access(tag * caches[level].numSets + index, hit,
+                                              !write || caches[level].writeAllocate);
+                }
+                if (profiling) {
+                    profile.record(level, index, hit);
+                }
+            }
+
+            if (way >= 0 || victimHit || streamHit) {
+                if (way >= 0) {
+                    caches[level].touch(index, way);
+                    prefetchedHit = Assist && prefetchers[level].use(index * caches[level].ways + way, clock, stall);
+                }
+                else {
+                    prefetchedHit = streamHit;
+                }
+                hits[level]++;
+                hitLevel = level;
+                hitWay = way;
+                if (Trace) {
+                    traceOut.field("Hit", 10).field(level + 1, 8).field(typeName, 12).newline();
+                    traceProgress(i, level, hits, misses);
+                }
+                break;
+            }
+
+            misses[level]++;
+            if (Trace) {
+                traceOut.field("Miss", 10).field(level + 1, 8).field(typeName, 12).newline();
+                traceProgress(i, level, hits, misses);
+            }
+        }
+
+        // Update the levels that missed, then apply a write where the line now lives
+        if (Assist && victimHit) {
+            takeFromVictimCache<PowerOfTwo>(hitLevel, write, victimDirty);
+        }
+        else if (Assist && streamHit) {
+            takeFromStream<PowerOfTwo>(hitLevel, address, write);
+        }
+        else if (hitLevel > 0) {
+            countFill(fill<PowerOfTwo, Assist>(0, hitLevel, hitWay, write), hitLevel);
+        }
+        if (write) {
+            writeDown<PowerOfTwo>(-1, address, WRITE_BYTES);
+        }
+
+        // The access took every level down to the one that answered, plus any wait for a late prefetch
+        if (Assist) {
+            prefetch<PowerOfTwo>(address, hitLevel, prefetchedHit, clock + stall);
+            uint64_t latency = stall;
+            for (int level = 0; level <= hitLevel; level++) {
+                latency += level < numLevels ? cacheATs[level] : memAT;
+            }
+            clock += latency;
+        }
+    }
+
+    // Brings the line of the current access into levels first to hitLevel - 1, each at its own index and
+    // tag, and returns the highest level holding it afterwards. A write skips the levels that do not
+    // allocate on writes. lineDirty marks a line an exclusive hierarchy moves up from elsewhere.
+    template <bool PowerOfTwo, bool Assist>
+    int fill(int first, int hitLevel, int hitWay, bool write, bool lineDirty = false) {
+        int numLevels = caches.size();
+        int top = hitLevel; // Highest level holding the line afterwards
+        if (inclusion == INCLUSION_EXCLUSIVE) {
+            if (write && !caches[first].writeAllocate) {
+                return top;
+            }
+            // The line moves up to the first level, dirty or not, and leaves the level it hit in
+            bool moved = hitLevel < numLevels && hitWay >= 0 && caches[hitLevel].invalidate(probeIndex[hitLevel], hitWay);
+            fillExclusive<PowerOfTwo, Assist>(first, probeIndex[first], probeTag[first], moved || lineDirty);
+            top = first;
+        }
+        else {
+            // Bottom up, so an inclusive back-invalidation never removes a line this access just placed
+            for (int level = hitLevel - 1; level >= first; level--) {
+                if (write && !caches[level].writeAllocate) {
+                    continue;
+                }
+                int64_t evicted;
+                bool evictedDirty;
+                int way = caches[level].fill(probeIndex[level], probeTag[level], evicted, evictedDirty);
+                top = level;
+                uint64_t victim; // Address of the line leaving the level
+                if (Assist) {
+                    prefetchers[level].filled(probeIndex[level] * caches[level].ways + way);
+                }
+                if (Assist && victimCaches[level].kind != VICTIM_NONE) {
+                    if (!throughVictimCache(level, probeIndex[level], probeTag[level], true, evicted, evictedDirty,
+                                            victim)) {
+                        continue;
+                    }
+                }
+                else {
+                    if (evicted == TAG_INVALID || (!evictedDirty && (inclusion != INCLUSION_INCLUSIVE || level == 0))) {
+                        continue;
+                    }
+                    victim = caches[level].blockAddress(probeIndex[level], evicted);
+                }
+                if (inclusion == INCLUSION_INCLUSIVE && level > 0) {
+                    evictedDirty |= backInvalidate<PowerOfTwo>(level, victim);
+                }
+                if (evictedDirty) {
+                    writebacks[level]++;
+                    writeDown<PowerOfTwo>(level, victim, caches[level].lineSize);
+                }
+            }
+        }
+        return top;
+    }
+
+    // Runs a fill of level through its victim or miss cache. A miss cache keeps a copy of a line fetched
+    // into the level; a victim cache takes the evicted line and lets its least recently used entry leave
+    // instead. Returns false when no line leaves, otherwise sets victim and evictedDirty to the one that does.
+    bool throughVictimCache(int level, int index, int64_t tag, bool fetched, int64_t evicted, bool& evictedDirty,
+                            uint64_t& victim) {
+        VictimCache& buffer = victimCaches[level];
+        const CacheLevel& cache = caches[level];
+        int64_t pushedLine;
+        bool pushedDirty;
+        if (buffer.kind == MISS_CACHE) {
+            if (fetched) {
+                buffer.insert(tag * cache.numSets + index, false, pushedLine, pushedDirty);
+            }
+        }
+        else if (evicted != TAG_INVALID) {
+            int64_t line = evicted * cache.numSets + index;
+            if (!buffer.insert(line, evictedDirty, pushedLine, pushedDirty)) {
+                return false;
+            }
+            victim = static_cast<uint64_t>(pushedLine) * cache.lineSize;
+            evictedDirty = pushedDirty;
+            return true;
+        }
+        if (evicted == TAG_INVALID) {
+            return false;
+        }
+        victim = cache.blockAddress(index, evicted);
+        return true;
+    }
+
+    // A line found in level's victim or miss cache is already at that level: it goes back into the level's
+    // lines, whose victim takes the freed entry, and then up as from a hit there. An exclusive hierarchy
+    // moves it straight to level 1. Either way it goes in like a read, since the level already holds it.
+    template <bool PowerOfTwo>
+    void takeFromVictimCache(int level, bool write, bool dirty) {
+        int top;
+        if (inclusion == INCLUSION_EXCLUSIVE) {
+            top = fill<PowerOfTwo, true>(0, level + 1, -1, false, dirty);
+        }
+        else {
+            fill<PowerOfTwo, true>(level, level + 1, -1, false);
+            int way = caches[level].find(probeIndex[level], probeTag[level]);
+            if (dirty) {
+                caches[level].markDirty(probeIndex[level], way);
+            }
+            top = fill<PowerOfTwo, true>(0, level, way, write);
+        }
+        countFill(top, level);
+    }
+
+    // The line crossed every boundary between the level it came from and the highest level it went to
+    void countFill(int top, int from) {
+        int numLevels = caches.size();
+        for (int level = top; level < from; level++) {
+            trafficBytes[level] += caches[level].lineSize;
+        }
+        if (from == numLevels && top < numLevels) {
+            memoryReadBytes += caches[numLevels - 1].lineSize;
+        }
+    }
+
+    // Exclusive fill: the line goes into the first level, and each level's victim (with its dirty bit) moves
+    // one level down until a level has a free way or the last level writes a dirty victim back to memory.
+    // A write-through level does not keep the dirty data of a line it receives but writes it on down.
+    template <bool PowerOfTwo, bool Assist>
+    void fillExclusive(int first, int index, int64_t tag, bool lineDirty) {
+        int numLevels = caches.size();
+        for (int level = first; level < numLevels; level++) {
+            int64_t evicted;
+            bool evictedDirty;
+            int way = caches[level].fill(index, tag, evicted, evictedDirty);
+            if (Assist) {
+                prefetchers[level].filled(index * caches[level].ways + way);
+            }
+            if (lineDirty) {
+                receiveDirty<PowerOfTwo>(level, index, tag, way);
+            }
+            uint64_t address;
+            if (Assist && victimCaches[level].kind != VICTIM_NONE) {
+                if (!throughVictimCache(level, index, tag, level == first, evicted, evictedDirty, address)) {
+                    return;
+                }
+            }
+            else {
+                if (evicted == TAG_INVALID) {
+                    return;
+                }
+                address = caches[level].blockAddress(index, evicted);
+            }
+            if (evictedDirty) {
+                writebacks[level]++;
+            }
+            if (level + 1 == numLevels) {
+                if (evictedDirty) {
+                    trafficBytes[level] += caches[level].lineSize;
+                    memoryWriteBytes += caches[level].lineSize;
+                }
+                return;
+            }
+            trafficBytes[level] += caches[level].lineSize;
+            caches[level + 1].locate<PowerOfTwo>(address, index, tag);
+            lineDirty = evictedDirty;
+
+            // With a longer line below, the victim's line may already be there
+            way = caches[level + 1].find(index, tag);
+            if (way >= 0) {
+                caches[level + 1].touch(index, way);
+                if (lineDirty) {
+                    receiveDirty<PowerOfTwo>(level + 1, index, tag, way);
+                }
+                return;
+            }
+        }
+    }
+
+    // Dirty data moved into way of level: a write-back level marks the line dirty, a write-through level
+    // passes the whole line on like a write
+    template <bool PowerOfTwo>
+    void receiveDirty(int level, int index, int64_t tag, int way) {
+        if (caches[level].writeBack) {
+            caches[level].markDirty(index, way);
+            return;
+        }
+        writeThroughs[level]++;
+        writeDown<PowerOfTwo>(level, caches[level].blockAddress(index, tag), caches[level].lineSize);
+    }
+
+    // Inclusive eviction from level: removes every line of the evicted range from the levels above and
+    // returns whether any of them was dirty, in which case the evicted line carries their data down
+    template <bool PowerOfTwo>
+    bool backInvalidate(int level, uint64_t address) {
+        bool anyDirty = false;
+        uint64_t end = address + caches[level].lineSize;
+        for (int upper = 0; upper < level; upper++) {
+            for (uint64_t part = address; part < end; part += caches[upper].lineSize) {
+                int index;
+                int64_t tag;
+                caches[upper].locate<PowerOfTwo>(part, index, tag);
+                int way = caches[upper].find(index, tag);
+                if (way >= 0) {
+                    anyDirty |= caches[upper].invalidate(index, way);
+                }
+                if (victimCaches[upper].kind != VICTIM_NONE) {
+                    anyDirty |= victimCaches[upper].invalidate(part / caches[upper].lineSize);
+                }
+            }
+        }
+        return anyDirty;
+    }
+
+    // Sends bytes of written data from level `from` (-1 for the processor) down the hierarchy: the first
+    // write-back level holding the line marks it dirty; write-through levels holding it pass the write on,
+    // and levels without the line let it through. Only data that reaches memory is written there.
+    template <bool PowerOfTwo>
+    void writeDown(int from, uint64_t address, int bytes) {
+        int numLevels = caches.size();
+        for (int level = from + 1; ; level++) {
+            if (level > 0) {
+                trafficBytes[level - 1] += bytes;
+            }
+            if (level == numLevels) {
+                memoryWriteBytes += bytes;
+                return;
+            }
+            int index;
+            int64_t tag;
+            caches[level].locate<PowerOfTwo>(address, index, tag);
+            int way = caches[level].find(index, tag);
+            if (way < 0) {
+                continue;
+            }
+            if (caches[level].writeBack) {
+                caches[level].markDirty(index, way);
+                return;
+            }
+            writeThroughs[level]++;
+        }
+    }
+
+    // A line taken from level's stream buffer goes into level and the levels above it as if it came from
+    // the first level below that holds it, which in an exclusive hierarchy gives it up. Only the boundaries
+    // above level are counted again; the prefetch already brought it across the rest.
+    template <bool PowerOfTwo>
+    void takeFromStream(int level, uint64_t address, bool write) {
+        int numLevels = caches.size();
+        int source = level + 1, sourceWay = -1;
+        for (; source < numLevels; source++) {
+            caches[source].locate<PowerOfTwo>(address, probeIndex[source], probeTag[source]);
+            sourceWay = caches[source].find(probeIndex[source], probeTag[source]);
+            if (sourceWay >= 0) {
+                break;
+            }
+        }
+        countFill(fill<PowerOfTwo, true>(0, source, sourceWay, write), level);
+    }
+
+    // Trains the prefetchers of the levels this access reached, each on the access's line at its level,
+    // and issues the lines they ask for as soon as the access has looked up that level, alongside the
+    // demand fetch from below. start is when the access began.
+    template <bool PowerOfTwo>
+    void prefetch(uint64_t address, int hitLevel, bool prefetchedHit, uint64_t start) {
+        int numLevels = caches.size();
+        uint64_t now = start;
+        for (int level = 0; level <= hitLevel && level < numLevels; level++) {
+            now += cacheATs[level];
+            if (prefetchers[level].kind == PREFETCH_NONE) {
+                continue;
+            }
+            candidates.clear();
+            prefetchers[level].train(address / caches[level].lineSize, level == hitLevel,
+                                     level == hitLevel && prefetchedHit, candidates);
+            for (int64_t line : candidates) {
+                issue<PowerOfTwo>(level, line, now);
+            }
+        }
+    }
+
+    // Prefetches line (numbered in level's lines) into level, or into its stream buffer, unless it is
+    // already there. It comes from the first level below that holds it, or memory, filling the levels in
+    // between as a demand miss would, and is ready once those access times have passed after now.
+    template <bool PowerOfTwo>
+    void issue(int level, int64_t line, uint64_t now) {
+        int numLevels = caches.size();
+        int lineSize = caches[level].lineSize;
+        if (line < 0 || (line + 1) * lineSize > (1LL << memoryBits)) {
+            return;
+        }
+        uint64_t address = static_cast<uint64_t>(line) * lineSize;
+        Prefetcher& prefetcher = prefetchers[level];
+
+        // Nothing to do if the level has the line, or in an exclusive hierarchy, any level above has part of it
+        caches[level].locate<PowerOfTwo>(address, probeIndex[level], probeTag[level]);
+        if (caches[level].find(probeIndex[level], probeTag[level]) >= 0) {
+            return;
+        }
+        if (inclusion == INCLUSION_EXCLUSIVE) {
+            for (int upper = 0; upper < level; upper++) {
+                for (uint64_t part = address; part < address + lineSize; part += caches[upper].lineSize) {
+                    int index;
+                    int64_t tag;
+                    caches[upper].locate<PowerOfTwo>(part, index, tag);
+                    if (caches[upper].find(index, tag) >= 0) {
+                        return;
+                    }
+                }
+            }
+        }
+        bool stream = prefetcher.kind == PREFETCH_STREAM;
+        if (stream && prefetcher.buffered(line)) {
+            return;
+        }
+
+        int source = level + 1, sourceWay = -1;
+        uint64_t latency = 0;
+        for (; source < numLevels; source++) {
+            latency += cacheATs[source];
+            caches[source].locate<PowerOfTwo>(address, probeIndex[source], probeTag[source]);
+            sourceWay = caches[source].find(probeIndex[source], probeTag[source]);
+            if (sourceWay >= 0) {
+                caches[source].touch(probeIndex[source], sourceWay);
+                break;
+            }
+        }
+        if (source == numLevels) {
+            latency += memAT;
+        }
+        prefetcher.issued++;
+        if (stream) {
+            prefetcher.push(line, now + latency);
+            countFill(level, source);
+            return;
+        }
+        countFill(fill<PowerOfTwo, true>(level, source, sourceWay, false), source);
+        int way = caches[level].find(probeIndex[level], probeTag[level]);
+        prefetcher.placed(probeIndex[level] * caches[level].ways + way, now + latency);
+    }
+
+    // Simulates the whole trace
+    template <bool PowerOfTwo, bool Trace, bool Assist, bool Instrument>
+    void simulate() {
+        size_t start = position;
+        position = forEachAddressIn(memAdds, writes, filePath, type, start, stopAt, [this](size_t i, uint64_t address, bool write) {
+            access<PowerOfTwo, Trace, Assist, Instrument>(i, address, write);
+        });
+        accesses += position - start;
+        if (Trace) {
+            traceOut.flush();
+        }
+    }
+
+    // Groups of sets set sampling splits addresses into: line numbers of the longest line modulo groups, the
+    // most groups for which every level's index determines the group. The accesses to any set of any level,
+    // and the lines it evicts, then stay within one group. 0 when some level is not a power of two.
+    uint64_t sampleGroups() const {
+        if (!allPowerOfTwo(caches)) {
+            return 0;
+        }
+        uint64_t longestLine = 1, groups = ~0ULL;
+        for (const CacheLevel& cache : caches) {
+            longestLine = max<uint64_t>(longestLine, cache.lineSize);
+        }
+        for (const CacheLevel& cache : caches) {
+            groups = min<uint64_t>(groups, static_cast<uint64_t>(cache.numSets) * cache.lineSize / longestLine);
+        }
+        return caches.empty() ? 0 : groups;
+    }
+
+    // Warming access between sampled windows: brings the line in and updates the replacement state like
+    // access(), and moves or invalidates lines as the inclusion policy does, but counts nothing. Written
+    // data only dirties the first write-back level below that holds its line, as writeDown() would leave it.
+    template <bool PowerOfTwo>
+    void warm(uint64_t address, bool write) {
+        int numLevels = caches.size();
+        int hitLevel = numLevels, hitWay = -1;
+        for (int level = 0; level < numLevels; level++) {
+            caches[level].locate<PowerOfTwo>(address, probeIndex[level], probeTag[level]);
+            hitWay = caches[level].find(probeIndex[level], probeTag[level]);
+            if (hitWay >= 0) {
+                caches[level].touch(probeIndex[level], hitWay);
+                hitLevel = level;
+                break;
+            }
+        }
+        if (hitLevel > 0 && inclusion == INCLUSION_EXCLUSIVE && !(write && !caches[0].writeAllocate)) {
+            // The line moves to level 1, and each victim one level down, with its dirty bit
+            bool dirty = hitLevel < numLevels && caches[hitLevel].invalidate(probeIndex[hitLevel], hitWay);
+            int index = probeIndex[0];
+            int64_t tag = probeTag[0];
+            for (int level = 0; level < numLevels; level++) {
+                int64_t evicted;
+                bool evictedDirty;
+                int way = caches[level].fill(index, tag, evicted, evictedDirty);
+                if (dirty && caches[level].writeBack) {
+                    caches[level].markDirty(index, way);
+                }
+                if (evicted == TAG_INVALID || level + 1 == numLevels) {
+                    break;
+                }
+                caches[level + 1].locate<PowerOfTwo>(caches[level].blockAddress(index, evicted), index, tag);
+                dirty = evictedDirty;
+                way = caches[level + 1].find(index, tag);
+                if (way >= 0) {
+                    caches[level + 1].touch(index, way);
+                    if (dirty && caches[level + 1].writeBack) {
+                        caches[level + 1].markDirty(index, way);
+                    }
+                    break;
+                }
+            }
+        }
+        else if (inclusion != INCLUSION_EXCLUSIVE) {
+            for (int level = hitLevel - 1; level >= 0; level--) {
+                if (write && !caches[level].writeAllocate) {
+                    continue;
+                }
+                int64_t evicted;
+                bool evictedDirty;
+                caches[level].fill(probeIndex[level], probeTag[level], evicted, evictedDirty);
+                if (evicted == TAG_INVALID) {
+                    continue;
+                }
+                uint64_t victim = caches[level].blockAddress(probeIndex[level], evicted);
+                if (inclusion == INCLUSION_INCLUSIVE && level > 0) {
+                    evictedDirty |= backInvalidate<PowerOfTwo>(level, victim);
+                }
+                if (evictedDirty) {
+                    warmDirty<PowerOfTwo>(level, victim);
+                }
+            }
+        }
+        if (write) {
+            warmDirty<PowerOfTwo>(-1, address);
+        }
+    }
+
+    // Marks the line of address dirty in the first write-back level below from that holds it
+    template <bool PowerOfTwo>
+    void warmDirty(int from, uint64_t address) {
+        for (int level = from + 1; level < static_cast<int>(caches.size()); level++) {
+            int index;
+            int64_t tag;
+            caches[level].locate<PowerOfTwo>(address, index, tag);
+            int way = caches[level].find(index, tag);
+            if (way >= 0 && caches[level].writeBack) {
+                caches[level].markDirty(index, way);
+                return;
+            }
+        }
+    }
+
+    // Hits in any level so far, and the cycles the AMAT charges below level 1 for what was counted so far:
+    // every miss and every write sent down pays the next level's (or memory's) access time
+    void sampleTotals(long long& totalHits, long long& cycles) const {
+        int numLevels = caches.size();
+        totalHits = 0;
+        cycles = 0;
+        for (int level = 0; level < numLevels; level++) {
+            int below = level + 1 < numLevels ? cacheATs[level + 1] : memAT;
+            totalHits += hits[level];
+            cycles += (misses[level] + writebacks[level] + writeThroughs[level]) * below;
+        }
+    }
+
+    // Sampled run. Every measured access is simulated like in a full run, and what it added to the counters
+    // is credited to its unit; the counters end up holding the measured accesses only, so the tables show
+    // the point estimates. Warming accesses only go through warm(), which keeps the levels' contents and
+    // counts nothing. Set sampling skips the other groups' accesses without simulating them.
+    template <bool PowerOfTwo>
+    void simulateSampled() {
+        int firstAT = caches.empty() ? memAT : cacheATs[0];
+        long long hitsBefore, cyclesBefore, hitsAfter, cyclesAfter;
+        units.clear();
+        if (sampling.kind == SAMPLE_SETS) {
+            // Only measured accesses are simulated, so the counters already hold them alone; each access's
+            // unit gets what the totals moved by
+            uint64_t groups = sampleGroups();
+            int lineShift = 0;
+            for (const CacheLevel& cache : caches) {
+                lineShift = max(lineShift, cache.offsetBits);
+            }
+            units.resize((groups + sampling.ratio - 1) / sampling.ratio);
+            traceAccesses = forEachAddress(memAdds, writes, filePath, type, [&](size_t i, uint64_t address, bool write) {
+                uint64_t group = (address >> lineShift) & (groups - 1);
+                if (group % sampling.ratio == 0) {
+                    SampleUnit& unit = units[group / sampling.ratio];
+                    sampleTotals(hitsBefore, cyclesBefore);
+                    access<PowerOfTwo, false, false, false>(i, address, write);
+                    sampleTotals(hitsAfter, cyclesAfter);
+                    unit.accesses++;
+                    unit.hits += hitsAfter - hitsBefore;
+                    unit.cycles += firstAT + static_cast<double>(cyclesAfter - cyclesBefore);
+                }
+            });
+        }
+        else {
+            // Windows are contiguous, so the counters are taken at their boundaries and what moved in between
+            // is the window's. Without a warmup length every access outside the windows is warmed.
+            int numLevels = caches.size();
+            vector<long long> measuredHits(numLevels, 0), measuredMisses(numLevels, 0),
+                measuredWritebacks(numLevels, 0), measuredWriteThroughs(numLevels, 0), measuredTraffic(numLevels, 0);
+            long long measuredRead = 0, measuredWritten = 0;
+            vector<long long> startHits, startMisses, startWritebacks, startWriteThroughs, startTraffic;
+            long long startRead = 0, startWritten = 0;
+            bool open = false;
+            auto openWindow = [&]() {
+                units.push_back(SampleUnit());
+                startHits = hits;
+                startMisses = misses;
+                startWritebacks = writebacks;
+                startWriteThroughs = writeThroughs;
+                startTraffic = trafficBytes;
+                startRead = memoryReadBytes;
+                startWritten = memoryWriteBytes;
+                sampleTotals(hitsBefore, cyclesBefore);
+                open = true;
+            };
+            auto closeWindow = [&]() {
+                SampleUnit& unit = units.back();
+                sampleTotals(hitsAfter, cyclesAfter);
+                unit.hits = hitsAfter - hitsBefore;
+                unit.cycles = static_cast<double>(unit.accesses) * firstAT + static_cast<double>(cyclesAfter - cyclesBefore);
+                for (int level = 0; level < numLevels; level++) {
+                    measuredHits[level] += hits[level] - startHits[level];
+                    measuredMisses[level] += misses[level] - startMisses[level];
+                    measuredWritebacks[level] += writebacks[level] - startWritebacks[level];
+                    measuredWriteThroughs[level] += writeThroughs[level] - startWriteThroughs[level];
+                    measuredTraffic[level] += trafficBytes[level] - startTraffic[level];
+                }
+                measuredRead += memoryReadBytes - startRead;
+                measuredWritten += memoryWriteBytes - startWritten;
+                open = false;
+            };
+
+            uint64_t warmFrom = sampling.warmup == 0 ? sampling.window : sampling.period - sampling.warmup;
+            traceAccesses = forEachAddress(memAdds, writes, filePath, type, [&](size_t i, uint64_t address, bool write) {
+                uint64_t phase = i % sampling.period;
+                if (phase < sampling.window) {
+                    if (phase == 0) {
+                        openWindow();
+                    }
+                    access<PowerOfTwo, false, false, false>(i, address, write);
+                    units.back().accesses++;
+                    if (phase + 1 == sampling.window) {
+                        closeWindow();
+                    }
+                }
+                else if (phase >= warmFrom) {
+                    warm<PowerOfTwo>(address, write);
+                }
+            });
+            if (open) {
+                closeWindow();
+            }
+
+            hits = measuredHits;
+            misses = measuredMisses;
+            writebacks = measuredWritebacks;
+            writeThroughs = measuredWriteThroughs;
+            trafficBytes = measuredTraffic;
+            memoryReadBytes = measuredRead;
+            memoryWriteBytes = measuredWritten;
+        }
+        accesses = 0;
+        for (const SampleUnit& unit : units) {
+            accesses += unit.accesses;
+        }
+    }
+
+    // Ratio estimate, over the measured units, of a quantity per access (value(unit) summed, divided by the
+    // units' accesses) and the half-width of its 95% confidence interval, from the Student-t distribution
+    // with one degree of freedom less than there are units and narrowed by the finite population correction
+    // for the fraction of the trace the units sample. The half-width is negative with fewer than two units,
+    // or no measured accesses.
+    template <typename Value>
+    void estimate(Value value, double& mean, double& halfWidth) const {
+        double total = 0, totalAccesses = 0;
+        for (const SampleUnit& unit : units) {
+            total += value(unit);
+            totalAccesses += unit.accesses;
+        }
+        mean = totalAccesses > 0 ? total / totalAccesses : 0;
+        halfWidth = -1;
+        size_t n = units.size();
+        if (n < 2 || totalAccesses == 0) {
+            return;
+        }
+        double squares = 0;
+        for (const SampleUnit& unit : units) {
+            double residual = value(unit) - mean * unit.accesses;
+            squares += residual * residual;
+        }
+        double fraction = sampling.kind == SAMPLE_SETS ? 1.0 / sampling.ratio
+                                                       : static_cast<double>(sampling.window) / sampling.period;
+        double perUnit = totalAccesses / n;
+        double variance = (1 - fraction) * squares / (n - 1) / (n * perUnit * perUnit);
+        halfWidth = confidenceQuantile(n - 1) * sqrt(variance);
+    }
+
+    // "0.9521 +/- 0.0031 cycles", or the estimate alone when there is no interval
+    static string withInterval(double mean, double halfWidth, const string& unit = "") {
+        stringstream text;
+        text << mean;
+        if (halfWidth >= 0) {
+            text << " +/- " << halfWidth;
+        }
+        text << unit;
+        if (halfWidth < 0) {
+            text << " (no interval from fewer than 2 units)";
+        }
+        return text.str();
+    }
+
+    // Hit ratio and AMAT estimated from the sample, with 95% confidence intervals. Prints nothing unless
+    // sample() was called.
+    void printSampling() const {
+        if (sampling.kind == SAMPLE_NONE) {
+            return;
+        }
+        cout << "\n" << typeName << " Sampling (";
+        if (sampling.kind == SAMPLE_SETS) {
+            cout << "1 of every " << sampling.ratio << " set groups, " << units.size() << " groups";
+        }
+        else {
+            cout << sampling.window << " of every " << sampling.period << " accesses, " << units.size() << " windows";
+        }
+        cout << "; " << accesses << " of " << traceAccesses << " accesses measured; 95% confidence):\n";
+        double mean, halfWidth;
+        estimate([](const SampleUnit& unit) { return static_cast<double>(unit.hits); }, mean, halfWidth);
+        cout << "Hit Ratio: " << withInterval(mean, halfWidth) << endl;
+        estimate([](const SampleUnit& unit) { return unit.cycles; }, mean, halfWidth);
+        cout << "AMAT: " << withInterval(mean, halfWidth, " cycles") << endl;
+    }
+
+    // Picks the simulate instantiation for this geometry; hierarchies without prefetchers or
+    // instrumentation never run any of their code
+    void run(bool trace) {
+        if (sampling.kind != SAMPLE_NONE) {
+            allPowerOfTwo(caches) ? simulateSampled<true>() : simulateSampled<false>();
+            return;
+        }
+        if (!instrumented()) {
+            assisted ? runWith<true, false>(trace) : runWith<false, false>(trace);
+        }
+        else {
+            assisted ? runWith<true, true>(trace) : runWith<false, true>(trace);
+        }
+    }
+
+    template <bool Assist, bool Instrument>
+    void runWith(bool trace) {
+        bool powerOfTwo = allPowerOfTwo(caches);
+        if (trace) {
+            powerOfTwo ? simulate<true, true, Assist, Instrument>() : simulate<false, true, Assist, Instrument>();
+        }
+        else {
+            powerOfTwo ? simulate<true, false, Assist, Instrument>() : simulate<false, false, Assist, Instrument>();
+        }
+    }
+
+    // Simulates the next access of the trace, for callers that feed addresses one at a time. The choice of
+    // instantiation is the same on every call, so the branches cost next to nothing.
+    void step(uint64_t address, bool write, bool trace) {
+        if (!instrumented()) {
+            assisted ? stepWith<true, false>(address, write, trace) : stepWith<false, false>(address, write, trace);
+        }
+        else {
+            assisted ? stepWith<true, true>(address, write, trace) : stepWith<false, true>(address, write, trace);
+        }
+    }
+
+    template <bool Assist, bool Instrument>
+    void stepWith(uint64_t address, bool write, bool trace) {
+        size_t i = accesses++;
+        bool powerOfTwo = allPowerOfTwo(caches);
+        if (trace) {
+            powerOfTwo ? access<true, true, Assist, Instrument>(i, address, write)
+                       : access<false, true, Assist, Instrument>(i, address, write);
+        }
+        else {
+            powerOfTwo ? access<true, false, Assist, Instrument>(i, address, write)
+                       : access<false, false, Assist, Instrument>(i, address, write);
+        }
+    }
+
+    // Pipelined schedule: a parser thread and one thread per level, each pinned to a core of its own when
+    // there are enough, connected by lock-free rings. Level k only sees what level k - 1 sends down: the
+    // accesses that missed there, followed by the data its fill evicted. Every level handles its messages
+    // in the order the serial access() would reach it with them, so the results are the same; throughput
+    // approaches that of the slowest level instead of the sum of all of them. Runs quietly and only
+    // non-inclusive hierarchies without prefetchers or victim caches, whose levels never look back up.
+    void runPipelined() {
+        if (caches.empty()) {
+            run(false);
+            return;
+        }
+        if (!instrumented()) {
+            allPowerOfTwo(caches) ? pipeline<true, false>() : pipeline<false, false>();
+        }
+        else {
+            allPowerOfTwo(caches) ? pipeline<true, true>() : pipeline<false, true>();
+        }
+    }
+
+    template <bool PowerOfTwo, bool Instrument>
+    void pipeline() {
+        int numLevels = caches.size();
+        vector<unique_ptr<SpscRing<PipelineMessage> > > rings; // rings[k] feeds level k
+        for (int level = 0; level < numLevels; level++) {
+            rings.emplace_back(new SpscRing<PipelineMessage>(PIPELINE_RING_SIZE));
+        }
+        vector<StageCounters> counters(numLevels);
+
+        // With stored miss streams, the run starts below the deepest level whose stream is there, and
+        // stores the streams of the levels it simulates. Standard input cannot be hashed up front.
+        int first = 0;
+        MissStreamReader replay;
+        string replayPath;
+        vector<unique_ptr<MissStreamWriter> > recorders(numLevels);
+        if (!missCacheDir.empty() && filePath != "-") {
+            const string& trace = traceHash(filePath);
+            for (int level = numLevels - 2; level >= 0 && first == 0; level--) {
+                if (replay.open(missStreamPath(trace, level), missStreamKey(trace, level))) {
+                    replayPath = missStreamPath(trace, level);
+                    first = level + 1;
+                }
+            }
+            for (int level = first; level + 1 < numLevels; level++) {
+                string path = missStreamPath(trace, level), error;
+                recorders[level].reset(new MissStreamWriter());
+                if (!recorders[level]->open(path, missStreamKey(trace, level), error)) {
+                    cerr << "Error writing file: " << path << " (" << error << ")" << endl;
+                    exit(1);
+                }
+            }
+        }
+
+        vector<thread> stages;
+        if (first == 0) {
+            stages.emplace_back([this, &rings]() {
+                SpscRing<PipelineMessage>& out = *rings[0];
+                accesses = forEachAddress(memAdds, writes, filePath, type, [&out](size_t, uint64_t address, bool write) {
+                    out.push({address, 0, PIPELINE_ACCESS, write});
+                });
+                out.push({0, 0, PIPELINE_END, false});
+                out.publish();
+            });
+        }
+        else {
+            stages.emplace_back([&rings, &replay, &replayPath, first]() {
+                SpscRing<PipelineMessage>& out = *rings[first];
+                PipelineMessage message;
+                while (replay.next(message)) {
+                    out.push(message);
+                }
+                if (replay.failed() || static_cast<int>(replay.levels.size()) != first) {
+                    cerr << "Error reading file: " << replayPath << " (truncated or corrupt miss stream)" << endl;
+                    exit(1);
+                }
+                out.push({0, 0, PIPELINE_END, false});
+                out.publish();
+            });
+        }
+        for (int level = first; level < numLevels; level++) {
+            StageOutput out;
+            out.ring = level + 1 < numLevels ? rings[level + 1].get() : nullptr;
+            out.record = recorders[level].get();
+            stages.emplace_back([this, level, &rings, out, &counters]() {
+                runStage<PowerOfTwo, Instrument>(level, *rings[level], out, counters[level]);
+            });
+        }
+        if (thread::hardware_concurrency() >= stages.size()) {
+            for (size_t core = 0; core < stages.size(); core++) {
+                pinToCore(stages[core], core);
+            }
+        }
+        for (thread& stage : stages) {
+            stage.join();
+        }
+
+        // The levels above first counted what they did when their stream was stored
+        if (first > 0) {
+            accesses = replay.accesses;
+            copy(replay.levels.begin(), replay.levels.end(), counters.begin());
+        }
+        for (int level = 0; level < numLevels; level++) {
+            addCounters(level, counters[level]);
+        }
+        for (int level = first; level + 1 < numLevels && recorders[level]; level++) {
+            string error;
+            vector<StageCounters> upstream(counters.begin(), counters.begin() + level + 1);
+            if (!recorders[level]->close(accesses, upstream, error)) {
+                cerr << "Error writing file: " << missStreamPath(traceHash(filePath), level) << " (" << error << ")" << endl;
+                exit(1);
+            }
+        }
+    }
+
+    // Identifies the miss stream leaving level: the trace's contents and the settings of every level down
+    // to it, which are all that decide what it sends
+    string missStreamKey(const string& trace, int level) const {
+        ostringstream key;
+        key << "trace " << trace << " store " << WRITE_BYTES << " levels";
+        for (int upper = 0; upper <= level; upper++) {
+            const CacheLevel& cache = caches[upper];
+            key << " " << cache.size << ":" << cache.lineSize << ":" << cache.ways << ":"
+                << policyName(cache.replacement.policy) << ":" << writePolicyName(cache.writePolicy());
+        }
+        return key.str();
+    }
+
+    string missStreamPath(const string& trace, int level) const {
+        ostringstream path;
+        path << missCacheDir << "/" << std::hex << setw(16) << setfill('0') << hashString(missStreamKey(trace, level))
+             << ".miss";
+        return path.str();
+    }
+
+    // Identifies what a checkpoint of this hierarchy holds: the trace, the settings of every level, the
+    // inclusion policy and the address width, which decides the width of the stored tags
+    string checkpointKey() const {
+        return missStreamKey(traceHash(filePath), static_cast<int>(caches.size()) - 1) + " inclusion " +
+            inclusionName(inclusion) + " bits " + to_string(memoryBits);
+    }
+
+    // Writes the levels' contents, the counters and the trace position to path
+    void saveState(const string& path) const {
+        CheckpointCounters counters;
+        counters.position = position;
+        counters.accesses = accesses;
+        counters.hits = hits;
+        counters.misses = misses;
+        counters.writebacks = writebacks;
+        counters.writeThroughs = writeThroughs;
+        counters.trafficBytes = trafficBytes;
+        counters.memoryReadBytes = memoryReadBytes;
+        counters.memoryWriteBytes = memoryWriteBytes;
+        string error;
+        if (!saveCheckpoint(path, checkpointKey(), caches, counters, error)) {
+            cerr << "Error writing file: " << path << " (" << error << ")" << endl;
+            exit(1);
+        }
+    }
+
+    // Restores what saveState() wrote, so the run continues the trace from the saved position. Without
+    // keepCounters the counters start from zero, and the accesses before the checkpoint only warmed the levels.
+    void loadState(const string& path, bool keepCounters) {
+        CheckpointCounters counters;
+        string error;
+        if (!loadCheckpoint(path, checkpointKey(), caches, counters, error)) {
+            cerr << "Error reading file: " << path << " (" << error << ")" << endl;
+            exit(1);
+        }
+        position = counters.position;
+        if (!keepCounters) {
+            return;
+        }
+        accesses = counters.accesses;
+        hits = counters.hits;
+        misses = counters.misses;
+        writebacks = counters.writebacks;
+        writeThroughs = counters.writeThroughs;
+        trafficBytes = counters.trafficBytes;
+        memoryReadBytes = counters.memoryReadBytes;
+        memoryWriteBytes = counters.memoryWriteBytes;
+    }
+
+    // Set-partitioned schedule for a hierarchy of one level, whose sets never interact: workers own
+    // interleaved blocks of SHARD_SETS sets each, and this thread reads the trace, buckets it by worker a
+    // chunk at a time and feeds every worker its accesses through a ring. Each set still sees its accesses
+    // in trace order, so the results are those of the serial run. Hierarchies with more levels, a policy
+    // with state across sets, or prefetchers, victim caches or instrumentation run serially.
+    void runSetPartitioned(unsigned threads) {
+        if (caches.size() != 1 || assisted || instrumented() || !caches[0].prepareShards()) {
+            run(false);
+            return;
+        }
+        caches[0].powerOfTwo ? partitionSets<true>(threads) : partitionSets<false>(threads);
+    }
+
+    template <bool PowerOfTwo>
+    void partitionSets(unsigned threads) {
+        const CacheLevel& cache = caches[0];
+        // A power of two of workers, at most one per block, so a block's worker is its number's low bits
+        unsigned blocks = (cache.numSets + SHARD_SETS - 1) / SHARD_SETS;
+        unsigned numWorkers = 1;
+        while (numWorkers * 2 <= threads && numWorkers * 2 <= blocks) {
+            numWorkers *= 2;
+        }
+        uint64_t workerMask = numWorkers - 1;
+
+        vector<unique_ptr<SpscRing<PipelineMessage> > > rings;
+        for (unsigned w = 0; w < numWorkers; w++) {
+            rings.emplace_back(new SpscRing<PipelineMessage>(PIPELINE_RING_SIZE));
+        }
+        vector<StageCounters> counters(numWorkers);
+        vector<thread> workers;
+        for (unsigned w = 0; w < numWorkers; w++) {
+            SpscRing<PipelineMessage>& in = *rings[w];
+            StageCounters& workerCounters = counters[w];
+            workers.emplace_back([this, &in, &workerCounters]() {
+                runStage<PowerOfTwo, false>(0, in, StageOutput(), workerCounters);
+            });
+        }
+        if (thread::hardware_concurrency() > numWorkers) {
+            for (unsigned w = 0; w < numWorkers; w++) {
+                pinToCore(workers[w], w + 1); // Core 0 is left to this thread
+            }
+        }
+
+        // Each chunk's workers are worked out in one pass over its addresses, which the compiler vectorizes
+        // for power-of-two geometries, and then handed out
+        const size_t BUCKET_CHUNK = 1024;
+        vector<uint64_t> chunk(BUCKET_CHUNK);
+        vector<uint8_t> chunkWrites(BUCKET_CHUNK);
+        vector<uint32_t> owners(BUCKET_CHUNK);
+        size_t filled = 0;
+        auto dispatch = [&]() {
+            for (size_t j = 0; j < filled; j++) {
+                int index;
+                int64_t tag;
+                cache.locate<PowerOfTwo>(chunk[j], index, tag);
+                owners[j] = static_cast<uint32_t>(static_cast<unsigned>(index) / SHARD_SETS & workerMask);
+            }
+            for (size_t j = 0; j < filled; j++) {
+                rings[owners[j]]->push({chunk[j], 0, PIPELINE_ACCESS, chunkWrites[j] != 0});
+            }
+            filled = 0;
+        };
+        accesses = forEachAddress(memAdds, writes, filePath, type, [&](size_t, uint64_t address, bool write) {
+            chunk[filled] = address;
+            chunkWrites[filled] = write;
+            if (++filled == BUCKET_CHUNK) {
+                dispatch();
+            }
+        });
+        dispatch();
+        for (unsigned w = 0; w < numWorkers; w++) {
+            rings[w]->push({0, 0, PIPELINE_END, false});
+            rings[w]->publish();
+        }
+
+        for (thread& worker : workers) {
+            worker.join();
+        }
+        for (const StageCounters& workerCounters : counters) {
+            addCounters(0, workerCounters);
+        }
+    }
+
+    // Adds what a stage or worker counted at level
+    void addCounters(int level, const StageCounters& counters) {
+        hits[level] += counters.hits;
+        misses[level] += counters.misses;
+        writebacks[level] += counters.writebacks;
+        writeThroughs[level] += counters.writeThroughs;
+        trafficBytes[level] += counters.trafficBytes;
+        memoryReadBytes += counters.memoryReadBytes;
+        memoryWriteBytes += counters.memoryWriteBytes;
+    }
+
+    // Level's stage: handles what comes in until the end of the trace, and sends down to out, or memory
+    // for the last level. Its output is published whenever it runs out of input, so the level below
+    // never waits on a part-filled batch.
+    template <bool PowerOfTwo, bool Instrument>
+    void runStage(int level, SpscRing<PipelineMessage>& in, StageOutput out, StageCounters& counters) {
+        CacheLevel& cache = caches[level];
+        bool writesFill = false; // A write missing every level down to this one fills at least one of them
+        for (int upper = 0; upper <= level; upper++) {
+            writesFill = writesFill || caches[upper].writeAllocate;
+        }
+
+        while (true) {
+            if (out.ring != nullptr && !in.ready()) {
+                out.ring->publish();
+            }
+            PipelineMessage message = in.pop();
+            if (message.kind == PIPELINE_END) {
+                if (out.ring != nullptr) {
+                    out.ring->push(message);
+                    out.ring->publish();
+                }
+                return;
+            }
+            if (message.kind == PIPELINE_WRITE) {
+                stageWrite<PowerOfTwo>(level, message.address, message.bytes, out, counters);
+                continue;
+            }
+
+            int index;
+            int64_t tag;
+            cache.locate<PowerOfTwo>(message.address, index, tag);
+            int way = cache.find(index, tag);
+            if (Instrument) {
+                if (level == 0 && profiling) {
+                    profile.access(message.address);
+                }
+                if (!classifiers.empty()) {
+                    classifiers[level].access(tag * cache.numSets + index, way >= 0,
+                                              !message.write || cache.writeAllocate);
+                }
+                if (profiling) {
+                    profile.record(level, index, way >= 0);
+                }
+            }
+
+            if (way >= 0) {
+                cache.touch(index, way);
+                counters.hits++;
+            }
+            else {
+                // The levels below look the line up before this one fills, as they do in access()
+                counters.misses++;
+                if (out.ring != nullptr) {
+                    out.push(message);
+                }
+                if (!message.write || writesFill) {
+                    counters.trafficBytes += cache.lineSize;
+                    if (out.ring == nullptr) {
+                        counters.memoryReadBytes += cache.lineSize;
+                    }
+                }
+                if (!message.write || cache.writeAllocate) {
+                    int64_t evicted;
+                    bool evictedDirty;
+                    cache.fill(index, tag, evicted, evictedDirty);
+                    if (evicted != TAG_INVALID && evictedDirty) {
+                        counters.writebacks++;
+                        stageSend(cache.blockAddress(index, evicted), cache.lineSize, out, counters);
+                    }
+                }
+            }
+            if (level == 0 && message.write) {
+                stageWrite<PowerOfTwo>(0, message.address, WRITE_BYTES, out, counters);
+            }
+        }
+    }
+
+    // writeDown() at one level: a write-back level holding the line marks it dirty, anything else passes
+    // the data on
+    template <bool PowerOfTwo>
+    void stageWrite(int level, uint64_t address, int bytes, StageOutput& out, StageCounters& counters) {
+        int index;
+        int64_t tag;
+        caches[level].locate<PowerOfTwo>(address, index, tag);
+        int way = caches[level].find(index, tag);
+        if (way >= 0 && caches[level].writeBack) {
+            caches[level].markDirty(index, way);
+            return;
+        }
+        if (way >= 0) {
+            counters.writeThroughs++;
+        }
+        stageSend(address, bytes, out, counters);
+    }
+
+    // Written data leaving a stage, to the next level or memory
+    void stageSend(uint64_t address, int bytes, StageOutput& out, StageCounters& counters) {
+        counters.trafficBytes += bytes;
+        if (out.ring != nullptr) {
+            out.push({address, bytes, PIPELINE_WRITE, false});
+        }
+        else {
+            counters.memoryWriteBytes += bytes;
+        }
+    }
+
+    // Per-level ratios and AMATs once the trace is done
+    void finish() {
+        hitRatios.assign(caches.size(), 0);
+        missRatios.assign(caches.size(), 0);
+        AMATs.assign(caches.size(), 0);
+        for (size_t level = 0; level < caches.size(); level++) {
+            long long totalAccesses = accesses;
+            hitRatios[level] = static_cast<float>(hits[level]) / totalAccesses;
+            missRatios[level] = static_cast<float>(misses[level]) / totalAccesses;
+            AMATs[level] = cacheATs[level] + missRatios[level] * memAT + writeCost(level) + prefetchStall(level);
+        }
+    }
+
+    // Cycles per access spent sending level's writebacks and write-through writes to the level below,
+    // each paying that level's (or memory's) access time
+    float writeCost(size_t level) const {
+        if (accesses == 0) {
+            return 0;
+        }
+        int below = level + 1 < caches.size() ? cacheATs[level + 1] : memAT;
+        return static_cast<float>(writebacks[level] + writeThroughs[level]) / accesses * below;
+    }
+
+    float writeCost() const {
+        float cost = 0;
+        for (size_t level = 0; level < caches.size(); level++) {
+            cost += writeCost(level);
+        }
+        return cost;
+    }
+
+    // Cycles per access that demand accesses waited at level for its late prefetches
+    float prefetchStall(size_t level) const {
+        return accesses > 0 ? static_cast<float>(prefetchers[level].lateCycles) / accesses : 0;
+    }
+
+    float prefetchStall() const {
+        float stall = 0;
+        for (size_t level = 0; level < caches.size(); level++) {
+            stall += prefetchStall(level);
+        }
+        return stall;
+    }
+
+    float amat() const {
+        return hierarchyAMAT(accesses, misses, cacheATs, writeCost() + prefetchStall());
+    }
+
+    void printSummary() const {
+        printSummaryRow(typeName, accesses, hits, misses, cacheATs, writeCost() + prefetchStall());
+    }
+
+    // Prefetcher and victim cache counters per level, and how hit ratios and AMATs moved against baseline,
+    // the same hierarchy run on the same trace without them. Prints nothing for a hierarchy with neither.
+    void printAssists(const CacheHierarchy& baseline) const {
+        bool anyPrefetcher = false, anyVictimCache = false;
+        for (size_t level = 0; level < caches.size(); level++) {
+            anyPrefetcher = anyPrefetcher || prefetchers[level].kind != PREFETCH_NONE;
+            anyVictimCache = anyVictimCache || victimCaches[level].kind != VICTIM_NONE;
+        }
+        if (!anyPrefetcher && !anyVictimCache) {
+            return;
+        }
+
+        string title = anyPrefetcher ? (anyVictimCache ? "Prefetching and Victim Caches" : "Prefetching") : "Victim Caches";
+        cout << "\n" << typeName << " " << title << " (change against the same hierarchy without them):\n";
+        cout << left << setw(8) << "Level";
+        if (anyPrefetcher) {
+            cout << setw(14) << "Prefetcher"
+                << setw(10) << "Issued"
+                << setw(10) << "Useful"
+                << setw(10) << "Late"
+                << setw(10) << "Useless";
+        }
+        if (anyVictimCache) {
+            cout << setw(12) << "Buffer"
+                << setw(10) << "Probes"
+                << setw(10) << "Hits";
+        }
+        cout << setw(12) << "Hit Ratio" << "AMAT (cycles)" << endl;
+        for (size_t level = 0; level < caches.size(); level++) {
+            cout << setw(8) << level + 1;
+            if (anyPrefetcher) {
+                const Prefetcher& prefetcher = prefetchers[level];
+                cout << setw(14) << prefetcher.describe()
+                    << setw(10) << prefetcher.issued
+                    << setw(10) << prefetcher.useful
+                    << setw(10) << prefetcher.late
+                    << setw(10) << prefetcher.useless();
+            }
+            if (anyVictimCache) {
+                const VictimCache& buffer = victimCaches[level];
+                cout << setw(12) << buffer.describe()
+                    << setw(10) << buffer.probes
+                    << setw(10) << buffer.hits;
+            }
+            cout << fixed << setprecision(4) << showpos
+                << setw(12) << hitRatios[level] - baseline.hitRatios[level]
+                << AMATs[level] - baseline.AMATs[level] << noshowpos << endl;
+            cout.unsetf(ios::floatfield);
+            cout << setprecision(6);
+        }
+        cout << "AMAT: " << baseline.amat() << " -> " << amat() << " cycles" << endl;
+    }
 
-vector<int> hits_data, hits_instr, misses_data, misses_instr; // Hits and misses per cache level
+    // Each level's misses split into the three Cs, as counts and shares of the level's misses. Prints
+    // nothing unless classifyMisses() was called.
+    void printMissClasses() const {
+        if (classifiers.empty()) {
+            return;
+        }
+        cout << "\n" << typeName << " Miss Classification (against a fully-associative LRU cache of the same size):\n";
+        cout << left << setw(8) << "Level"
+            << setw(10) << "Misses"
+            << setw(20) << "Compulsory"
+            << setw(20) << "Capacity"
+            << "Conflict" << endl;
+        for (size_t level = 0; level < caches.size(); level++) {
+            const MissClassifier& classifier = classifiers[level];
+            cout << setw(8) << level + 1
+                << setw(10) << misses[level]
+                << setw(20) << missShare(classifier.compulsory, misses[level])
+                << setw(20) << missShare(classifier.capacity, misses[level])
+                << missShare(classifier.conflict, misses[level]) << endl;
+        }
+    }
+
+    // "120 (9.68%)"
+    static string missShare(uint64_t count, long long levelMisses) {
+        stringstream text;
+        text << count << " (" << fixed << setprecision(2)
+            << (levelMisses > 0 ? 100.0 * count / levelMisses : 0) << "%)";
+        return text.str();
+    }
+
+    void printLevels() const {
+        cout << "\n" << typeName << " Cache Simulation Results:\n";
+        cout << left << setw(8) << "Level"
+            << setw(10) << "Hits"
+            << setw(10) << "Misses"
+            << setw(12) << "Hit Ratio"
+            << setw(12) << "Miss Ratio"
+            << "AMAT (cycles)" << endl;
+        for (size_t level = 0; level < caches.size(); level++) {
+            cout << setw(8) << level + 1
+                << setw(10) << hits[level]
+                << setw(10) << misses[level]
+                << setw(12) << hitRatios[level]
+                << setw(12) << missRatios[level]
+                << AMATs[level] << endl;
+        }
+
+        cout << "\n" << typeName << " Cache Traffic (bytes exchanged with the level below):\n";
+        cout << left << setw(8) << "Level"
+            << setw(10) << "Policy"
+            << setw(12) << "Writebacks"
+            << setw(16) << "Write-throughs"
+            << "Traffic (bytes)" << endl;
+        for (size_t level = 0; level < caches.size(); level++) {
+            cout << setw(8) << level + 1
+                << setw(10) << writePolicyName(caches[level].writePolicy())
+                << setw(12) << writebacks[level]
+                << setw(16) << writeThroughs[level]
+                << trafficBytes[level] << endl;
+        }
+        cout << "Memory: " << memoryReadBytes << " bytes read, " << memoryWriteBytes << " bytes written" << endl;
+    }
+
+    // One JSON object with the totals of the summary row and, per level, the results and traffic
+    void writeJson(ostream& out) const {
+        long long totalHits = 0;
+        for (long long levelHits : hits) {
+            totalHits += levelHits;
+        }
+        out << "    {\"name\": " << jsonString(typeName)
+            << ", \"type\": \"" << traceTypeName(type) << "\""
+            << ", \"trace\": " << jsonString(filePath)
+            << ",\n     \"accesses\": " << accesses
+            << ", \"hits\": " << totalHits
+            << ", \"misses\": " << (misses.empty() ? static_cast<long long>(accesses) : misses.back())
+            << ", \"hitRatio\": " << (accesses > 0 ? static_cast<float>(totalHits) / accesses : 0)
+            << ", \"amat\": " << amat()
+            << ", \"memoryReadBytes\": " << memoryReadBytes
+            << ", \"memoryWriteBytes\": " << memoryWriteBytes
+            << ",\n     \"levels\": [";
+        for (size_t level = 0; level < caches.size(); level++) {
+            const CacheLevel& cache = caches[level];
+            out << (level > 0 ? "," : "") << "\n       {\"level\": " << level + 1
+                << ", \"size\": " << cache.size
+                << ", \"lineSize\": " << cache.lineSize
+                << ", \"ways\": " << cache.ways
+                << ", \"writePolicy\": \"" << writePolicyName(cache.writePolicy()) << "\""
+                << ", \"accessTime\": " << cacheATs[level]
+                << ", \"accesses\": " << hits[level] + misses[level]
+                << ", \"hits\": " << hits[level]
+                << ", \"misses\": " << misses[level]
+                << ", \"hitRatio\": " << hitRatios[level]
+                << ", \"missRatio\": " << missRatios[level]
+                << ", \"amat\": " << AMATs[level]
+                << ", \"writebacks\": " << writebacks[level]
+                << ", \"writeThroughs\": " << writeThroughs[level]
+                << ", \"trafficBytes\": " << trafficBytes[level] << "}";
+        }
+        out << "\n     ]}";
+    }
+
+    // CSV rows: one per level, then the totals as level "all" with the level-only columns left empty
+    void writeCsv(ostream& out) const {
+        for (size_t level = 0; level < caches.size(); level++) {
+            const CacheLevel& cache = caches[level];
+            out << typeName << "," << level + 1 << "," << cache.size << "," << cache.lineSize << "," << cache.ways
+                << "," << writePolicyName(cache.writePolicy()) << "," << cacheATs[level]
+                << "," << hits[level] + misses[level] << "," << hits[level] << "," << misses[level]
+                << "," << hitRatios[level] << "," << missRatios[level] << "," << AMATs[level]
+                << "," << writebacks[level] << "," << writeThroughs[level] << "," << trafficBytes[level] << "\n";
+        }
+        long long totalHits = 0;
+        for (long long levelHits : hits) {
+            totalHits += levelHits;
+        }
+        out << typeName << ",all,,,,,," << accesses << "," << totalHits
+            << "," << (misses.empty() ? static_cast<long long>(accesses) : misses.back())
+            << "," << (accesses > 0 ? static_cast<float>(totalHits) / accesses : 0) << ","
+            << "," << amat() << ",,,\n";
+    }
+
+    void printContents() const {
+        for (size_t level = 0; level < caches.size(); level++) {
+            printCacheContents(typeName, level, caches[level], !writes.empty());
+        }
+    }
+};
+
+// One address at a time from a trace: the loaded addresses, or chunks of its file in streaming mode
+class TraceCursor {
+public:
+    TraceCursor(const vector<uint64_t>& memAdds, const vector<bool>& writes, const string& filePath, TraceType type)
+        : memAdds(memAdds), writes(writes), filePath(filePath) {
+        if (!streamMode) {
+            return;
+        }
+        string error;
+        if (!stream.open(filePath, error)) {
+            cerr << "Error reading file: " << filePath << " (" << error << ")" << endl;
+            exit(1);
+        }
+        if (stream.isBinary()) {
+            checkTraceHeader(filePath, stream.header(), type);
+        }
+    }
+
+    bool next(uint64_t& address, bool& write) {
+        const vector<uint64_t>& source = streamMode ? chunk : memAdds;
+        if (position == source.size()) {
+            if (!streamMode || !refill()) {
+                return false;
+            }
+        }
+        const vector<bool>& flags = streamMode ? chunkWrites : writes;
+        write = !flags.empty() && flags[position];
+        address = streamMode ? chunk[position++] : memAdds[position++];
+        return true;
+    }
+
+private:
+    bool refill() {
+        position = 0;
+        if (stream.next(chunk, chunkWrites)) {
+            checkAddresses(filePath, chunk, read);
+            read += chunk.size();
+            return true;
+        }
+        if (stream.failed()) {
+            cerr << "Error reading file: " << filePath << " (" << stream.error() << ")" << endl;
+            exit(1);
+        }
+        return false;
+    }
+
+    const vector<uint64_t>& memAdds;
+    const vector<bool>& writes;
+    string filePath;
+    TraceStream stream;
+    vector<uint64_t> chunk;
+    vector<bool> chunkWrites;
+    size_t position = 0;
+    size_t read = 0; // Addresses streamed before the current chunk
+};
+
+// How cacheSim() runs the two hierarchies: one after the other, on two threads, on one thread with their
+// accesses interleaved one for one as a single timeline, or one after the other with each one's levels
+// pipelined across threads or, for single levels, each one's sets split across threads
+enum Schedule {
+    SCHEDULE_SEQUENTIAL,
+    SCHEDULE_THREADS,
+    SCHEDULE_INTERLEAVED,
+    SCHEDULE_PIPELINE,
+    SCHEDULE_SETS
+};
+Schedule schedule = SCHEDULE_THREADS;
+InclusionPolicy inclusion = INCLUSION_NINE; // Applies to both hierarchies and to every sweep hierarchy
+
+// A prefetcher from --prefetch, attached to one level of the data or instruction hierarchy
+struct PrefetchOption {
+    TraceType side;
+    int level; // From 1, as in the prompts
+    PrefetcherKind kind;
+    int degree;
+};
+vector<PrefetchOption> prefetchOptions;
+
+// A victim or miss cache from --victim-cache
+struct VictimCacheOption {
+    TraceType side;
+    int level;
+    VictimCacheKind kind;
+    int entries;
+};
+vector<VictimCacheOption> victimCacheOptions;
+
+bool classifyMisses = false; // Split every level's misses into compulsory, capacity and conflict misses
+string profileFile; // Where to export reuse distances and per-set pressure, as JSON for a .json name or CSV
+string resultsFile; // Where to export the results, the same way
+string configFile; // Memory and hierarchies to simulate instead of the prompts
+SampleOption sampleOption; // From --sample, kind SAMPLE_NONE for full runs
+string saveCheckpointDir, loadCheckpointDir; // Where hierarchies store their state after the run and find it before
+bool resetCounters = false; // A loaded checkpoint only warms the levels, and counting starts from zero
+size_t stopAfter = 0; // Trace accesses each hierarchy simulates before stopping, 0 for all of them
+
+// File a hierarchy's checkpoint is kept in, within directory
+string checkpointPath(const string& directory, const string& typeName) {
+    return directory + "/" + typeName + ".ckpt";
+}
+
+// Splits a level option written as side:level:kind[:count] into its fields, checking the side and level
+bool parseLevelOption(const string& text, TraceType& side, int& level, vector<string>& fields) {
+    stringstream stream(text);
+    string field;
+    while (getline(stream, field, ':')) {
+        fields.push_back(field);
+    }
+    if (fields.size() < 3 || fields.size() > 4) {
+        return false;
+    }
+    if (fields[0] == "data") {
+        side = TRACE_DATA;
+    }
+    else if (fields[0] == "instruction") {
+        side = TRACE_INSTRUCTION;
+    }
+    else {
+        return false;
+    }
+    level = atoi(fields[1].c_str());
+    return level >= 1;
+}
 
-// Hit ratios, miss ratios, and average memory access time per cache level
-vector<float> hitRatios_data, hitRatios_instr, missRatios_data, missRatios_instr, AMATs_data, AMATs_instr;
+// Parses side:level:kind[:degree], e.g. data:1:next-line:2. The degree is the lines fetched per trigger,
+// or the depth of a stream buffer, and defaults to 1 (4 for a stream buffer).
+bool parsePrefetchOption(const string& text, PrefetchOption& option) {
+    vector<string> fields;
+    if (!parseLevelOption(text, option.side, option.level, fields) || !parsePrefetcher(fields[2], option.kind) ||
+        option.kind == PREFETCH_NONE) {
+        return false;
+    }
+    option.degree = fields.size() == 4 ? atoi(fields[3].c_str()) : (option.kind == PREFETCH_STREAM ? 4 : 1);
+    return option.degree >= 1 && option.degree <= MAX_PREFETCH_DEGREE;
+}
 
-vector<int> instructionMemAdds; // Instruction memory addresses
-vector<int> dataMemAdds; // Data memory addresses
+// Parses side:level:victim|miss[:entries], e.g. data:1:victim:4. Entries default to 4.
+bool parseVictimCacheOption(const string& text, VictimCacheOption& option) {
+    vector<string> fields;
+    if (!parseLevelOption(text, option.side, option.level, fields) || !parseVictimCache(fields[2], option.kind) ||
+        option.kind == VICTIM_NONE) {
+        return false;
+    }
+    option.entries = fields.size() == 4 ? atoi(fields[3].c_str()) : 4;
+    return option.entries >= 1 && option.entries <= MAX_VICTIM_ENTRIES;
+}
 
-// Function to read memory addresses from a file
-void readFile(const string& filePath, vector<int>& memAdds) {
-    ifstream inputFile(filePath);
-    if (!inputFile) {
-        cerr << "Error opening file: " << filePath << endl;
-        exit(1);
+// Parses periodic:<window>:<period>[:<warmup>], e.g. periodic:1000:100000, or sets:<ratio>, e.g. sets:16
+bool parseSampleOption(const string& text, SampleOption& option) {
+    vector<string> fields;
+    stringstream stream(text);
+    string field;
+    while (getline(stream, field, ':')) {
+        fields.push_back(field);
     }
-    string line, address;
-    while (getline(inputFile, line)) {
-        stringstream ss(line);
-        while (getline(ss, address, ',')) {
-            memAdds.push_back(stoi(address)); // Store memory accesses
-        }
+    if (fields.size() == 2 && fields[0] == "sets") {
+        option.kind = SAMPLE_SETS;
+        option.ratio = static_cast<unsigned>(atoi(fields[1].c_str()));
+        return atoi(fields[1].c_str()) >= 2;
     }
-    inputFile.close();
+    if ((fields.size() == 3 || fields.size() == 4) && fields[0] == "periodic") {
+        option.kind = SAMPLE_PERIODIC;
+        option.window = strtoull(fields[1].c_str(), nullptr, 10);
+        option.period = strtoull(fields[2].c_str(), nullptr, 10);
+        option.warmup = fields.size() == 4 ? strtoull(fields[3].c_str(), nullptr, 10) : 0;
+        return option.window >= 1 && option.period > option.window && option.warmup <= option.period - option.window;
+    }
+    return false;
 }
 
+// One hierarchy to simulate and its trace: the data and instruction hierarchies of the prompts, or the
+// hierarchies of a config file
+struct HierarchyConfig {
+    string name; // As shown in the trace and the tables
+    TraceType type;
+    string traceFile;
+    vector<CacheLevel> levels;
+    vector<int> cacheATs;
+    vector<uint64_t> memAdds; // Loaded addresses, unused in streaming mode
+    vector<bool> writes;
+};
 
-// Cache Simulation Function
-void cacheSim() {
-
-    // Initializing our values for data cache
-    hits_data.assign(numLevels_data, 0);
-    misses_data.assign(numLevels_data, 0);
-    hitRatios_data.assign(numLevels_data, 0);
-    missRatios_data.assign(numLevels_data, 0);
-    AMATs_data.assign(numLevels_data, 0);
-
-    // Initializing our values for instruction cache
-    hits_instr.assign(numLevels_instr, 0);
-    misses_instr.assign(numLevels_instr, 0);
-    hitRatios_instr.assign(numLevels_instr, 0);
-    missRatios_instr.assign(numLevels_instr, 0);
-    AMATs_instr.assign(numLevels_instr, 0);
-
-    // Initialize cache levels for data cache
-    vector<vector<CacheLine> > caches_data(numLevels_data);
-    for (int i = 0; i < numLevels_data; i++) {
-        int numLines_data = cacheSizes_data[i] / cacheLineSizes_data[i];
-        caches_data[i] = vector<CacheLine>(numLines_data);
+// Builds the hierarchies of configs, ready to run, with the command line's prefetchers, victim caches
+// and instrumentation attached
+void buildHierarchies(vector<HierarchyConfig>& configs, vector<CacheHierarchy>& hierarchies, bool instrumented) {
+    hierarchies.reserve(configs.size());
+    for (HierarchyConfig& config : configs) {
+        hierarchies.emplace_back(config.name, config.type, config.memAdds, config.writes, config.traceFile,
+                                 config.levels, config.cacheATs, inclusion);
+        if (!instrumented) {
+            continue;
+        }
+        CacheHierarchy& hierarchy = hierarchies.back();
+        for (const PrefetchOption& option : prefetchOptions) {
+            if (option.side == config.type) {
+                hierarchy.attachPrefetcher(option.level - 1, option.kind, option.degree);
+            }
+        }
+        for (const VictimCacheOption& option : victimCacheOptions) {
+            if (option.side == config.type) {
+                hierarchy.attachVictimCache(option.level - 1, option.kind, option.entries);
+            }
+        }
+        if (classifyMisses) {
+            hierarchy.classifyMisses();
+        }
+        if (!profileFile.empty()) {
+            hierarchy.profileAccesses();
+        }
+        if (sampleOption.kind == SAMPLE_SETS && hierarchy.sampleGroups() < sampleOption.ratio) {
+            cerr << "--sample sets:" << sampleOption.ratio << " needs power-of-two line sizes and set counts, and at least "
+                << sampleOption.ratio << " set groups; " << config.name << " has " << hierarchy.sampleGroups() << endl;
+            exit(1);
+        }
+        if (sampleOption.kind != SAMPLE_NONE) {
+            hierarchy.sample(sampleOption);
+        }
     }
+}
 
-    // Initialize cache levels for instruction cache
-    vector<vector<CacheLine> > caches_instr(numLevels_instr);
-    for (int i = 0; i < numLevels_instr; i++) {
-        int numLines_instr = cacheSizes_instr[i] / cacheLineSizes_instr[i];
-        caches_instr[i] = vector<CacheLine>(numLines_instr);
+// Runs every hierarchy quietly, the first on this thread and each other one on a thread of its own when
+// threads is set
+void runAll(vector<CacheHierarchy>& hierarchies, bool threads) {
+    if (!threads) {
+        for (CacheHierarchy& hierarchy : hierarchies) {
+            hierarchy.run(false);
+        }
+        return;
     }
+    vector<thread> workers;
+    for (size_t i = 1; i < hierarchies.size(); i++) {
+        CacheHierarchy& hierarchy = hierarchies[i];
+        workers.emplace_back([&hierarchy]() { hierarchy.run(false); });
+    }
+    if (!hierarchies.empty()) {
+        hierarchies[0].run(false);
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+}
 
-    // Output for tracing data cache
-    cout << "Tracing Data Cache:" << endl;
-    cout << left << setw(8) << "Access"
-        << setw(12) << "Address"
-        << setw(8) << "Index"
-        << setw(8) << "Tag"
-        << setw(6) << "VB"
-        << setw(8) << "CTag"
-        << setw(10) << "Result"
-        << setw(8) << "Level"
-        << setw(12) << "Type" << endl;
-
-    // Process data cache accesses
-    for (size_t i = 0; i < dataMemAdds.size(); i++) {
-        int address = dataMemAdds[i];
-        bool hit = false;
-
-        for (int level = 0; level < numLevels_data; level++) {
-            int cacheLines = cacheSizes_data[level] / cacheLineSizes_data[level];
-            int index = (address / cacheLineSizes_data[level]) % cacheLines;
-            int tag = (address / cacheLineSizes_data[level]) / cacheLines;
-
-            // Trace the access
-            cout << setw(8) << i + 1
-                << setw(12) << address
-                << setw(8) << index
-                << setw(8) << tag
-                << setw(6) << caches_data[level][index].VB
-                << setw(8) << caches_data[level][index].tag;
-
-            if (caches_data[level][index].VB && caches_data[level][index].tag == tag) {
-                cout << setw(10) << "Hit"
-                    << setw(8) << level + 1
-                    << setw(12) << "Data" << endl;
-                hits_data[level]++;
-                hit = true;
-                cout << "-------------------------------------------------------------------" << endl;
-                cout << "Number of accesses so far: " << i << endl;
-                cout << "Level " << level + 1 << ":" << endl;
-                cout << "Number of hits so far: " << hits_data[level] << endl;
-                cout << "Number of misses so far: " << misses_data[level] << endl;
-                cout << "-------------------------------------------------------------------" << endl;
-                break;
+// Interleaved schedule: the next access of each trace in turn until all are done
+void simulateInterleaved(vector<CacheHierarchy>& hierarchies, bool trace) {
+    vector<unique_ptr<TraceCursor> > cursors;
+    for (const CacheHierarchy& hierarchy : hierarchies) {
+        cursors.push_back(unique_ptr<TraceCursor>(
+            new TraceCursor(hierarchy.memAdds, hierarchy.writes, hierarchy.filePath, hierarchy.type)));
+    }
+    vector<bool> left(hierarchies.size(), true);
+    size_t remaining = hierarchies.size();
+    uint64_t address;
+    bool write;
+    while (remaining > 0) {
+        for (size_t i = 0; i < hierarchies.size(); i++) {
+            if (!left[i]) {
+                continue;
+            }
+            if (cursors[i]->next(address, write)) {
+                hierarchies[i].step(address, write, trace);
             }
             else {
-                cout << setw(10) << "Miss"
-                    << setw(8) << level + 1
-                    << setw(12) << "Data" << endl;
-                misses_data[level]++;
+                left[i] = false;
+                remaining--;
             }
+        }
+    }
+    if (trace) {
+        traceOut.flush();
+    }
+}
 
-            // Update cache on miss at current level
-            if (!hit && level == numLevels_data - 1) {
-                caches_data[0][index].VB = true;
-                caches_data[0][index].tag = tag;
-            }
+// "Data and Instruction", or "A, B and C"
+string joinNames(const vector<CacheHierarchy>& hierarchies) {
+    string names;
+    for (size_t i = 0; i < hierarchies.size(); i++) {
+        if (i > 0) {
+            names += i + 1 == hierarchies.size() ? " and " : ", ";
+        }
+        names += hierarchies[i].typeName;
+    }
+    return names;
+}
 
-            cout << "-------------------------------------------------------------------" << endl;
-            cout << "Number of accesses so far: " << i << endl;
-            cout << "Level " << level + 1 << ":" << endl;
-            cout << "Number of hits so far: " << hits_data[level] << endl;
-            cout << "Number of misses so far: " << misses_data[level] << endl;
-            cout << "-------------------------------------------------------------------" << endl;
+// Exports the access profiles of all hierarchies to profileFile
+void writeProfile(const vector<CacheHierarchy>& hierarchies) {
+    ofstream outputFile(profileFile);
+    if (isJsonPath(profileFile)) {
+        outputFile << "{";
+        for (size_t i = 0; i < hierarchies.size(); i++) {
+            outputFile << (i > 0 ? "," : "") << "\n  " << jsonString(hierarchies[i].typeName) << ": ";
+            hierarchies[i].profile.writeJson(outputFile);
+        }
+        outputFile << "\n}\n";
+    }
+    else {
+        AccessProfile::writeCsvHeader(outputFile);
+        for (const CacheHierarchy& hierarchy : hierarchies) {
+            hierarchy.profile.writeCsv(outputFile, hierarchy.typeName);
         }
+    }
+    if (!outputFile) {
+        cerr << "Error writing file: " << profileFile << endl;
+        exit(1);
+    }
+    cout << "\nAccess profile written to " << profileFile << endl;
+}
 
+// Exports the results of all hierarchies to resultsFile: per hierarchy its totals, and per level the
+// figures of the levels table and the traffic table
+void writeResults(const vector<CacheHierarchy>& hierarchies) {
+    ofstream outputFile(resultsFile);
+    if (isJsonPath(resultsFile)) {
+        outputFile << "{\n  \"memory\": {\"bits\": " << memoryBits << ", \"accessTime\": " << memAT
+            << "},\n  \"hierarchies\": [";
+        for (size_t i = 0; i < hierarchies.size(); i++) {
+            outputFile << (i > 0 ? "," : "") << "\n";
+            hierarchies[i].writeJson(outputFile);
+        }
+        outputFile << "\n  ]\n}\n";
+    }
+    else {
+        outputFile << "hierarchy,level,size,line_size,ways,write_policy,access_time,accesses,hits,misses,hit_ratio,"
+            "miss_ratio,amat,writebacks,write_throughs,traffic_bytes\n";
+        for (const CacheHierarchy& hierarchy : hierarchies) {
+            hierarchy.writeCsv(outputFile);
+        }
+    }
+    if (!outputFile) {
+        cerr << "Error writing file: " << resultsFile << endl;
+        exit(1);
     }
+    cout << "\nResults written to " << resultsFile << endl;
+}
 
-    cout << endl << endl << endl << endl;
+// Cache Simulation Function
+void cacheSim(vector<HierarchyConfig>& configs) {
+    vector<CacheHierarchy> hierarchies;
+    buildHierarchies(configs, hierarchies, true);
 
-    // Output for tracing instruction cache
-    cout << "\nTracing Instruction Cache:" << endl;
-    cout << left << setw(8) << "Access"
-        << setw(12) << "Address"
-        << setw(8) << "Index"
-        << setw(8) << "Tag"
-        << setw(6) << "VB"
-        << setw(8) << "CTag"
-        << setw(10) << "Result"
-        << setw(8) << "Level"
-        << setw(12) << "Type" << endl;
+    // A checkpoint puts each hierarchy back where an earlier run left it
+    for (CacheHierarchy& hierarchy : hierarchies) {
+        if (!loadCheckpointDir.empty()) {
+            hierarchy.loadState(checkpointPath(loadCheckpointDir, hierarchy.typeName), !resetCounters);
+        }
+        if (stopAfter > 0) {
+            hierarchy.stopAt = hierarchy.position + stopAfter;
+        }
+    }
 
-    // Process instruction cache accesses
-    for (size_t i = 0; i < instructionMemAdds.size(); i++) {
-        int address = instructionMemAdds[i];
-        bool hit = false;
-
-        for (int level = 0; level < numLevels_instr; level++) {
-            int cacheLines = cacheSizes_instr[level] / cacheLineSizes_instr[level];
-            int index = (address / cacheLineSizes_instr[level]) % cacheLines;
-            int tag = (address / cacheLineSizes_instr[level]) / cacheLines;
-
-            // Trace the access
-            cout << setw(8) << i + 1
-                << setw(12) << address
-                << setw(8) << index
-                << setw(8) << tag
-                << setw(6) << caches_instr[level][index].VB
-                << setw(8) << caches_instr[level][index].tag;
-
-            if (caches_instr[level][index].VB && caches_instr[level][index].tag == tag) {
-                cout << setw(10) << "Hit"
-                    << setw(8) << level + 1
-                    << setw(12) << "Instruction" << endl;
-                hits_instr[level]++;
-                hit = true;
-                cout << "-------------------------------------------------------------------" << endl;
-                cout << "Number of accesses so far: " << i << endl;
-                cout << "Level " << level + 1 << ":" << endl;
-                cout << "Number of hits so far: " << hits_instr[level] << endl;
-                cout << "Number of misses so far: " << misses_instr[level] << endl;
-                cout << "-------------------------------------------------------------------" << endl;
-                break;
-            }
-            else {
-                cout << setw(10) << "Miss"
-                    << setw(8) << level + 1
-                    << setw(12) << "Instruction" << endl;
-                misses_instr[level]++;
-            }
+    bool tracing = verbosity == VERBOSITY_TRACE;
 
-            // Update cache on miss at current level
-            if (!hit && level == numLevels_instr - 1) {
-                caches_instr[0][index].VB = true;
-                caches_instr[0][index].tag = tag;
+    if (schedule == SCHEDULE_INTERLEAVED) {
+        if (tracing) {
+            cout << "Tracing " << joinNames(hierarchies) << " Caches:" << endl;
+            printTraceHeader();
+        }
+        simulateInterleaved(hierarchies, tracing);
+    }
+    else if (schedule == SCHEDULE_THREADS && !tracing) {
+        runAll(hierarchies, true);
+    }
+    else if (schedule == SCHEDULE_PIPELINE) {
+        for (CacheHierarchy& hierarchy : hierarchies) {
+            hierarchy.runPipelined();
+        }
+    }
+    else if (schedule == SCHEDULE_SETS) {
+        for (CacheHierarchy& hierarchy : hierarchies) {
+            hierarchy.runSetPartitioned(workerThreads);
+        }
+    }
+    else {
+        for (size_t i = 0; i < hierarchies.size(); i++) {
+            // Output for tracing this hierarchy, set apart from the one before
+            if (tracing) {
+                if (i > 0) {
+                    cout << endl << endl << endl << endl << "\n";
+                }
+                cout << "Tracing " << hierarchies[i].typeName << " Cache:" << endl;
+                printTraceHeader();
             }
-            cout << "-------------------------------------------------------------------" << endl;
-            cout << "Number of accesses so far: " << i << endl;
-            cout << "Level " << level + 1 << ":" << endl;
-            cout << "Number of hits so far: " << hits_instr[level] << endl;
-            cout << "Number of misses so far: " << misses_instr[level] << endl;
-            cout << "-------------------------------------------------------------------" << endl;
+            hierarchies[i].run(tracing);
         }
     }
 
-    // Calculations for data and instruction cache AMATs
-    for (int level = 0; level < numLevels_data; level++) {
-        int totalAccesses = dataMemAdds.size();
-        hitRatios_data[level] = static_cast<float>(hits_data[level]) / totalAccesses;
-        missRatios_data[level] = static_cast<float>(misses_data[level]) / totalAccesses;
-        AMATs_data[level] = cacheATs_data[level] + missRatios_data[level] * memAT;
+    if (!saveCheckpointDir.empty()) {
+        for (const CacheHierarchy& hierarchy : hierarchies) {
+            hierarchy.saveState(checkpointPath(saveCheckpointDir, hierarchy.typeName));
+        }
     }
 
-    for (int level = 0; level < numLevels_instr; level++) {
-        int totalAccesses = instructionMemAdds.size();
-        hitRatios_instr[level] = static_cast<float>(hits_instr[level]) / totalAccesses;
-        missRatios_instr[level] = static_cast<float>(misses_instr[level]) / totalAccesses;
-        AMATs_instr[level] = cacheATs_instr[level] + missRatios_instr[level] * memAT;
+    // Calculations for per-level ratios and AMATs
+    for (CacheHierarchy& hierarchy : hierarchies) {
+        hierarchy.finish();
     }
 
     // Print results
-    cout << "\nData Cache Simulation Results:\n";
-    cout << left << setw(8) << "Level"
+    cout << "\nSimulation Summary:\n";
+    cout << left << setw(14) << "Cache"
+        << setw(12) << "Accesses"
         << setw(10) << "Hits"
         << setw(10) << "Misses"
         << setw(12) << "Hit Ratio"
-        << setw(12) << "Miss Ratio"
         << "AMAT (cycles)" << endl;
-    for (int level = 0; level < numLevels_data; level++) {
-        cout << setw(8) << level + 1
-            << setw(10) << hits_data[level]
-            << setw(10) << misses_data[level]
-            << setw(12) << hitRatios_data[level]
-            << setw(12) << missRatios_data[level]
-            << AMATs_data[level] << endl;
+    for (const CacheHierarchy& hierarchy : hierarchies) {
+        hierarchy.printSummary();
+    }
+    for (const CacheHierarchy& hierarchy : hierarchies) {
+        hierarchy.printSampling();
+    }
+    for (const CacheHierarchy& hierarchy : hierarchies) {
+        hierarchy.printMissClasses();
+    }
+    if (!profileFile.empty()) {
+        writeProfile(hierarchies);
     }
 
-    cout << "\nInstruction Cache Simulation Results:\n";
-    cout << left << setw(8) << "Level"
-        << setw(10) << "Hits"
-        << setw(10) << "Misses"
-        << setw(12) << "Hit Ratio"
-        << setw(12) << "Miss Ratio"
-        << "AMAT (cycles)" << endl;
-    for (int level = 0; level < numLevels_instr; level++) {
-        cout << setw(8) << level + 1
-            << setw(10) << hits_instr[level]
-            << setw(10) << misses_instr[level]
-            << setw(12) << hitRatios_instr[level]
-            << setw(12) << missRatios_instr[level]
-            << AMATs_instr[level] << endl;
+    // Prefetchers and victim caches are measured against the same hierarchies run again without them
+    if (!prefetchOptions.empty() || !victimCacheOptions.empty()) {
+        vector<CacheHierarchy> baselines;
+        buildHierarchies(configs, baselines, false);
+        runAll(baselines, schedule == SCHEDULE_THREADS);
+        for (size_t i = 0; i < hierarchies.size(); i++) {
+            baselines[i].finish();
+            hierarchies[i].printAssists(baselines[i]);
+        }
+    }
+
+    if (!resultsFile.empty()) {
+        writeResults(hierarchies);
+    }
+    if (!saveCheckpointDir.empty()) {
+        cout << "\nCheckpoints of " << joinNames(hierarchies) << " written to " << saveCheckpointDir << endl;
+    }
+
+    if (verbosity < VERBOSITY_LEVELS) {
+        return;
+    }
+
+    for (const CacheHierarchy& hierarchy : hierarchies) {
+        hierarchy.printLevels();
+    }
+
+    if (!tracing) {
+        return;
     }
 
     cout << endl << endl << endl << endl;
 
     // Display final tags and VBs of all modified entries
-    for(int i = 0; i < numLevels_data; i++){
-        cout << "Data Cache Level " << i + 1 << ":" <<endl;
-        cout << left << setw(8) << "Index"
-             << setw(12) << "VB" << setw(8) << "Tag" <<endl;
-        for(int j = 0; j < caches_data[i].size(); j++){
-            cout << setw(8) << j
-                 << setw(12) << caches_data[i][j].VB  << setw(8) << caches_data[i][j].tag <<endl;
+    for (size_t i = 0; i < hierarchies.size(); i++) {
+        if (i > 0) {
+            traceOut.newline();
+        }
+        hierarchies[i].printContents();
+    }
+    traceOut.flush();
+}
+
+// One row of a stack-distance table: an LRU cache of the given geometry in front of memory
+void printCapacityRow(long long capacity, long long shape, uint64_t hits, uint64_t accesses, int accessTime) {
+    uint64_t misses = accesses - hits;
+    float missRatio = accesses > 0 ? static_cast<float>(misses) / accesses : 0;
+    cout << setw(16) << capacity
+        << setw(10) << shape
+        << setw(12) << hits
+        << setw(12) << misses
+        << setw(12) << 1 - missRatio
+        << accessTime + missRatio * memAT << endl;
+}
+
+// Hits and misses of every LRU capacity at the level 1 line size, from one pass over the trace: every
+// fully-associative size, and every associativity with the level 1 set count
+void stackDistanceProfile(const string& typeName, const vector<uint64_t>& memAdds, const vector<bool>& writes,
+                          const string& filePath, TraceType type, const CacheLevel& level1, int accessTime) {
+    StackDistanceAnalyzer fullyAssociative(level1.lineSize);
+    StackDistanceAnalyzer perSet(level1.lineSize, level1.numSets);
+    size_t accesses = forEachAddress(memAdds, writes, filePath, type, [&](size_t, uint64_t address, bool) {
+        fullyAssociative.access(address);
+        perSet.access(address);
+    });
+
+    cout << typeName << " Stack Distance Profile (" << level1.lineSize << "-byte lines, " << accesses
+        << " accesses, " << fullyAssociative.distinctLines() << " distinct lines):" << endl;
+    cout << "Fully associative LRU:" << endl;
+    cout << left << setw(16) << "Capacity (B)"
+        << setw(10) << "Lines"
+        << setw(12) << "Hits"
+        << setw(12) << "Misses"
+        << setw(12) << "Hit Ratio"
+        << "AMAT (cycles)" << endl;
+    // Doubling sizes until every line fits, after which only cold misses remain
+    for (long long lines = 1; ; lines *= 2) {
+        printCapacityRow(lines * level1.lineSize, lines, fullyAssociative.hits(lines), accesses, accessTime);
+        if (static_cast<uint64_t>(lines) >= fullyAssociative.distinctLines()) {
+            break;
+        }
+    }
+
+    cout << "LRU with " << level1.numSets << " sets:" << endl;
+    cout << left << setw(16) << "Capacity (B)"
+        << setw(10) << "Ways"
+        << setw(12) << "Hits"
+        << setw(12) << "Misses"
+        << setw(12) << "Hit Ratio"
+        << "AMAT (cycles)" << endl;
+    for (long long ways = 1; ways <= 64; ways *= 2) {
+        printCapacityRow(ways * level1.numSets * level1.lineSize, ways, perSet.hits(ways), accesses, accessTime);
+    }
+}
+
+// Stack-distance mode: capacity sweeps for level 1 of every hierarchy instead of the configured simulation
+void stackDistanceSim(const vector<HierarchyConfig>& configs) {
+    for (size_t i = 0; i < configs.size(); i++) {
+        if (i > 0) {
+            cout << endl;
+        }
+        const HierarchyConfig& config = configs[i];
+        stackDistanceProfile(config.name, config.memAdds, config.writes, config.traceFile, config.type,
+                             config.levels[0], config.cacheATs[0]);
+    }
+}
+
+// One hierarchy of a sweep, from one line of the sweep file
+struct SweepConfig {
+    string text; // The line as written, for the result table
+    vector<CacheLevel> levels;
+    vector<int> cacheATs;
+};
+
+// Results of one sweep hierarchy. Workers count into their own vectors and store the totals here once,
+// and each result has cache lines of its own so neighbouring configurations never share one.
+struct alignas(64) SweepResult {
+    size_t accesses = 0;
+    vector<long long> hits, misses;
+    float writeCost = 0;
+};
+
+// Parses one level written as size:lineSize:ways:accessTime[:policy[:write policy]], with the interactive
+// input's limits
+bool parseSweepLevel(const string& text, vector<CacheLevel>& levels, vector<int>& cacheATs, string& error) {
+    vector<string> fields;
+    stringstream stream(text);
+    string field;
+    while (getline(stream, field, ':')) {
+        fields.push_back(field);
+    }
+    if (fields.size() < 4 || fields.size() > 6) {
+        error = "expected size:lineSize:ways:accessTime[:policy[:write policy]], got " + text;
+        return false;
+    }
+    long long size = atoll(fields[0].c_str());
+    int lineSize = atoi(fields[1].c_str());
+    int ways = atoi(fields[2].c_str());
+    int accessTime = atoi(fields[3].c_str());
+    ReplacementPolicy policy = POLICY_LRU;
+    if (size <= 0 || lineSize <= 0 || size % lineSize != 0) {
+        error = "size must be a positive multiple of the line size in " + text;
+        return false;
+    }
+    if (size / lineSize > INT_MAX) {
+        error = "more than " + to_string(INT_MAX) + " lines in " + text;
+        return false;
+    }
+    if (ways < 1 || ways > 64 || (size / lineSize) % ways != 0) {
+        error = "ways must be 1 to 64 and evenly divide the lines in " + text;
+        return false;
+    }
+    if (accessTime < 1 || accessTime > 10) {
+        error = "access time must be 1 to 10 cycles in " + text;
+        return false;
+    }
+    WritePolicy write = WRITE_BACK_ALLOCATE;
+    if (fields.size() == 6 && !parseWritePolicy(fields[5], write)) {
+        error = "unknown write policy (WB-WA, WB-NWA, WT-WA or WT-NWA) in " + text;
+        return false;
+    }
+    if (fields.size() >= 5 && (!parsePolicy(fields[4], policy) ||
+                               (policy == POLICY_PLRU && !CacheLevel::isPowerOfTwo(ways)))) {
+        error = "unknown policy, or PLRU without power-of-two ways, in " + text;
+        return false;
+    }
+    levels.push_back(CacheLevel(size, lineSize, ways, policy, write, memoryBits));
+    cacheATs.push_back(accessTime);
+    return true;
+}
+
+// Reads a sweep file: one hierarchy per line, its levels separated by spaces, # starting a comment
+void readSweepFile(const string& filePath, vector<SweepConfig>& configs) {
+    ifstream file(filePath);
+    if (!file) {
+        cerr << "Error reading file: " << filePath << endl;
+        exit(1);
+    }
+    string line;
+    int lineNumber = 0;
+    while (getline(file, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        stringstream levels(line);
+        SweepConfig config;
+        string level, error;
+        while (levels >> level) {
+            if (!parseSweepLevel(level, config.levels, config.cacheATs, error)) {
+                cerr << "Error reading file: " << filePath << " (line " << lineNumber << ": " << error << ")" << endl;
+                exit(1);
+            }
+            config.text += (config.text.empty() ? "" : " ") + level;
+        }
+        if (!config.levels.empty()) {
+            configs.push_back(config);
+        }
+    }
+    if (configs.empty()) {
+        cerr << "Error reading file: " << filePath << " (no hierarchies)" << endl;
+        exit(1);
+    }
+}
+
+// Sweep mode: every hierarchy of the sweep file against one trace, loaded once and shared read-only
+// by the pool's workers, reported as one summary table in file order
+void sweepSim(const string& sweepFile, const string& traceFile, unsigned threads) {
+    vector<SweepConfig> configs;
+    readSweepFile(sweepFile, configs);
+    vector<SweepResult> results(configs.size());
+
+    WorkStealingPool pool(threads);
+    auto start = chrono::steady_clock::now();
+    pool.run(configs.size(), [&](size_t i) {
+        CacheHierarchy hierarchy("Data", TRACE_DATA, dataMemAdds, dataWrites, traceFile, configs[i].levels,
+                                 configs[i].cacheATs, inclusion);
+        hierarchy.run(false);
+        results[i].accesses = hierarchy.accesses;
+        results[i].writeCost = hierarchy.writeCost();
+        results[i].hits.swap(hierarchy.hits);
+        results[i].misses.swap(hierarchy.misses);
+    });
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "Sweep Results (" << configs.size() << " hierarchies on " << pool.threads() << " threads, "
+        << seconds << " s):" << endl;
+    cout << left << setw(14) << "Config"
+        << setw(12) << "Accesses"
+        << setw(10) << "Hits"
+        << setw(10) << "Memory"
+        << setw(12) << "Hit Ratio"
+        << setw(14) << "AMAT (cycles)"
+        << "Hierarchy" << endl;
+    for (size_t i = 0; i < configs.size(); i++) {
+        printSummaryRow(to_string(i + 1), results[i].accesses, results[i].hits, results[i].misses,
+                        configs[i].cacheATs, results[i].writeCost, configs[i].text);
+    }
+}
+
+// Reads a config file, the non-interactive form of the prompts: the memory and any number of hierarchies.
+// # starts a comment, and levels are written as in a sweep file:
+//   [memory]
+//   bits = 32
+//   access_time = 100
+//   [hierarchy Data]
+//   type = data
+//   trace = data.txt
+//   level = 1024:32:2:1:LRU:WB-WA
+//   level = 16384:64:8:4
+void readConfigFile(const string& filePath, vector<HierarchyConfig>& configs) {
+    ifstream file(filePath);
+    if (!file) {
+        cerr << "Error reading file: " << filePath << endl;
+        exit(1);
+    }
+    memoryBits = 0;
+    memAT = 0;
+    string section, line, error;
+    int lineNumber = 0;
+    vector<vector<pair<int, string> > > levelLines; // Per hierarchy, parsed once [memory] gives the tag width
+    while (getline(file, line) && error.empty()) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        line.erase(0, line.find_first_not_of(" \t\r"));
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (line.empty()) {
+            continue;
+        }
+
+        if (line.front() == '[' && line.back() == ']') {
+            stringstream header(line.substr(1, line.size() - 2));
+            string name, extra;
+            header >> section >> name >> extra;
+            if (section == "hierarchy" && !name.empty() && extra.empty() &&
+                name.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_-") == string::npos) {
+                for (const HierarchyConfig& config : configs) {
+                    if (config.name == name) {
+                        error = "hierarchy " + name + " appears twice";
+                    }
+                }
+                configs.push_back(HierarchyConfig());
+                configs.back().name = name;
+                configs.back().type = TRACE_DATA;
+                levelLines.push_back(vector<pair<int, string> >());
+            }
+            else if (section != "memory" || !name.empty()) {
+                error = "expected [memory] or [hierarchy <name>] with a name of letters, digits, _ and -, got " + line;
+            }
+            continue;
+        }
+
+        size_t equals = line.find('=');
+        if (equals == string::npos) {
+            error = "expected key = value, got " + line;
+            continue;
+        }
+        string key = line.substr(0, line.find_last_not_of(" \t", equals - 1) + 1);
+        string value = line.substr(equals + 1);
+        value.erase(0, value.find_first_not_of(" \t"));
+        if (section == "memory" && key == "bits") {
+            memoryBits = atoi(value.c_str());
+        }
+        else if (section == "memory" && key == "access_time") {
+            memAT = atoi(value.c_str());
+        }
+        else if (section == "hierarchy" && key == "type" && value == "data") {
+            configs.back().type = TRACE_DATA;
+        }
+        else if (section == "hierarchy" && key == "type" && value == "instruction") {
+            configs.back().type = TRACE_INSTRUCTION;
+        }
+        else if (section == "hierarchy" && key == "trace" && !value.empty()) {
+            configs.back().traceFile = value;
+        }
+        else if (section == "hierarchy" && key == "level") {
+            levelLines.back().push_back(make_pair(lineNumber, value));
+        }
+        else {
+            error = "unexpected " + line + (section.empty() ? " outside a section" : " in [" + section + "]");
+        }
+    }
+
+    if (!error.empty()) {
+        cerr << "Error reading file: " << filePath << " (line " << lineNumber << ": " << error << ")" << endl;
+        exit(1);
+    }
+
+    if (memoryBits < 16 || memoryBits > 40) {
+        error = "[memory] needs bits from 16 to 40";
+    }
+    if (error.empty() && (memAT < 50 || memAT > 200)) {
+        error = "[memory] needs an access_time from 50 to 200 cycles";
+    }
+    for (size_t i = 0; i < configs.size() && error.empty(); i++) {
+        for (const pair<int, string>& level : levelLines[i]) {
+            if (!parseSweepLevel(level.second, configs[i].levels, configs[i].cacheATs, error)) {
+                cerr << "Error reading file: " << filePath << " (line " << level.first << ": " << error << ")" << endl;
+                exit(1);
+            }
+        }
+    }
+    for (const HierarchyConfig& config : configs) {
+        if (error.empty() && (config.traceFile.empty() || config.levels.empty())) {
+            error = "hierarchy " + config.name + " needs a trace and at least one level";
+        }
+    }
+    if (error.empty() && configs.empty()) {
+        error = "no hierarchies";
+    }
+    if (!error.empty()) {
+        cerr << "Error reading file: " << filePath << " (" << error << ")" << endl;
+        exit(1);
+    }
+}
+
+// Checks that the command line's per-level options and trace sources fit the hierarchies, then loads the
+// traces unless they are streamed. Returns false after reporting a problem.
+bool loadHierarchies(vector<HierarchyConfig>& configs) {
+    for (const PrefetchOption& option : prefetchOptions) {
+        for (const HierarchyConfig& config : configs) {
+            if (config.type == option.side && option.level > static_cast<int>(config.levels.size())) {
+                cerr << "--prefetch level " << option.level << " is beyond the " << config.levels.size()
+                    << " cache levels of " << config.name << endl;
+                return false;
+            }
+        }
+    }
+    for (const VictimCacheOption& option : victimCacheOptions) {
+        for (const HierarchyConfig& config : configs) {
+            if (config.type == option.side && option.level > static_cast<int>(config.levels.size())) {
+                cerr << "--victim-cache level " << option.level << " is beyond the " << config.levels.size()
+                    << " cache levels of " << config.name << endl;
+                return false;
+            }
         }
     }
 
-    cout << endl;
+    // "-" reads a trace from standard input
+    int fromInput = 0;
+    for (const HierarchyConfig& config : configs) {
+        fromInput += config.traceFile == "-" ? 1 : 0;
+    }
+    if (fromInput > 1) {
+        cerr << "Only one trace can be read from standard input" << endl;
+        return false;
+    }
+    if (!streamMode && fromInput > 0) {
+        cerr << "Reading a trace from standard input requires --stream" << endl;
+        return false;
+    }
+    if (fromInput > 0 && (!prefetchOptions.empty() || !victimCacheOptions.empty())) {
+        cerr << "--prefetch and --victim-cache read each trace twice, with and without them, so they cannot read standard input" << endl;
+        return false;
+    }
+    if (fromInput > 0 && (!saveCheckpointDir.empty() || !loadCheckpointDir.empty())) {
+        cerr << "Checkpoints are tied to the contents of their trace, so they cannot be taken of standard input" << endl;
+        return false;
+    }
 
-    for(int i = 0; i < numLevels_instr; i++){
-        cout << "Instruction Cache Level " << i + 1 << ":" <<endl;
-        cout << left << setw(8) << "Index"
-             << setw(12) << "VB" << setw(8) << "Tag" <<endl;
-        for(int j = 0; j < caches_instr[i].size(); j++){
-            cout << setw(8) << j
-                 << setw(12) << caches_instr[i][j].VB  << setw(8) << caches_instr[i][j].tag <<endl;
+    // In streaming mode the traces are read chunk by chunk while simulating
+    if (!streamMode) {
+        for (HierarchyConfig& config : configs) {
+            readFile(config.traceFile, config.memAdds, config.writes, config.type);
         }
     }
+    return true;
+}
+
+// Input for the associativity of one level and, when it has more than one way, its replacement policy
+void readOrganization(const string& typeName, int level, int numLines, int& ways, ReplacementPolicy& policy) {
+    cout << "Level " << level + 1 << " " << typeName << " cache associativity (1 = direct-mapped, up to 64 ways): ";
+    cin >> ways;
+    while(ways < 1 || ways > 64 || numLines % ways != 0){
+        cout << "Invalid input. Please enter 1 to 64 ways that evenly divide the " << numLines << " lines:" << endl;
+        cin >> ways;
+    }
+
+    policy = POLICY_LRU;
+    if (ways == 1) {
+        return;
+    }
+    string name;
+    cout << "Level " << level + 1 << " " << typeName << " cache replacement policy (LRU, PLRU, SRRIP, BRRIP, FIFO, RANDOM): ";
+    cin >> name;
+    while(!parsePolicy(name, policy) || (policy == POLICY_PLRU && !CacheLevel::isPowerOfTwo(ways))){
+        cout << "Invalid input. Please enter LRU, PLRU, SRRIP, BRRIP, FIFO or RANDOM (PLRU needs power-of-two ways):" << endl;
+        cin >> name;
+    }
 }
 
 // Main Driver Function
-int main() {
+int main(int argc, char* argv[]) {
+    // Command line options
+    PrefetchOption prefetch;
+    VictimCacheOption victimCache;
+    for (int i = 1; i < argc; i++) {
+        string option = argv[i];
+        if (option == "--stream") {
+            streamMode = true;
+        }
+        else if (option == "--stack-distance") {
+            stackDistanceMode = true;
+        }
+        else if (option == "--schedule" && i + 1 < argc && string(argv[i + 1]) == "sequential") {
+            schedule = SCHEDULE_SEQUENTIAL;
+            i++;
+        }
+        else if (option == "--schedule" && i + 1 < argc && string(argv[i + 1]) == "threads") {
+            schedule = SCHEDULE_THREADS;
+            i++;
+        }
+        else if (option == "--schedule" && i + 1 < argc && string(argv[i + 1]) == "interleaved") {
+            schedule = SCHEDULE_INTERLEAVED;
+            i++;
+        }
+        else if (option == "--schedule" && i + 1 < argc && string(argv[i + 1]) == "pipeline") {
+            schedule = SCHEDULE_PIPELINE;
+            i++;
+        }
+        else if (option == "--schedule" && i + 1 < argc && string(argv[i + 1]) == "sets") {
+            schedule = SCHEDULE_SETS;
+            i++;
+        }
+        else if (option == "--inclusion" && i + 1 < argc && parseInclusion(argv[i + 1], inclusion)) {
+            i++;
+        }
+        else if (option == "--sweep" && i + 1 < argc) {
+            sweepFile = argv[++i];
+        }
+        else if (option == "--threads" && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            workerThreads = atoi(argv[++i]);
+        }
+        else if (option == "--prefetch" && i + 1 < argc && parsePrefetchOption(argv[i + 1], prefetch)) {
+            prefetchOptions.push_back(prefetch);
+            i++;
+        }
+        else if (option == "--victim-cache" && i + 1 < argc && parseVictimCacheOption(argv[i + 1], victimCache)) {
+            victimCacheOptions.push_back(victimCache);
+            i++;
+        }
+        else if (option == "--classify-misses") {
+            classifyMisses = true;
+        }
+        else if (option == "--profile" && i + 1 < argc) {
+            profileFile = argv[++i];
+        }
+        else if (option == "--config" && i + 1 < argc) {
+            configFile = argv[++i];
+        }
+        else if (option == "--miss-cache" && i + 1 < argc) {
+            missCacheDir = argv[++i];
+        }
+        else if (option == "--sample" && i + 1 < argc && parseSampleOption(argv[i + 1], sampleOption)) {
+            i++;
+        }
+        else if (option == "--save-checkpoint" && i + 1 < argc) {
+            saveCheckpointDir = argv[++i];
+        }
+        else if (option == "--load-checkpoint" && i + 1 < argc) {
+            loadCheckpointDir = argv[++i];
+        }
+        else if (option == "--reset-counters") {
+            resetCounters = true;
+        }
+        else if (option == "--stop-after" && i + 1 < argc && strtoull(argv[i + 1], nullptr, 10) > 0) {
+            stopAfter = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (option == "--results" && i + 1 < argc) {
+            resultsFile = argv[++i];
+        }
+        else if (option == "--verbosity" && i + 1 < argc && string(argv[i + 1]) == "summary") {
+            verbosity = VERBOSITY_SUMMARY;
+            i++;
+        }
+        else if (option == "--verbosity" && i + 1 < argc && string(argv[i + 1]) == "levels") {
+            verbosity = VERBOSITY_LEVELS;
+            i++;
+        }
+        else if (option == "--verbosity" && i + 1 < argc && string(argv[i + 1]) == "trace") {
+            verbosity = VERBOSITY_TRACE;
+            i++;
+        }
+        else {
+            cerr << "Usage: Cache_Simulator [--config <file>] [--results <file.csv|file.json>]" << endl;
+            cerr << "                       [--stream] [--stack-distance] [--verbosity summary|levels|trace]" << endl;
+            cerr << "                       [--schedule sequential|threads|interleaved|pipeline|sets] [--threads N]" << endl;
+            cerr << "                       [--inclusion nine|inclusive|exclusive]" << endl;
+            cerr << "                       [--prefetch data|instruction:<level>:next-line|stride|stream[:<degree>]]..." << endl;
+            cerr << "                       [--victim-cache data|instruction:<level>:victim|miss[:<entries>]]..." << endl;
+            cerr << "                       [--classify-misses] [--profile <file.csv|file.json>] [--miss-cache <directory>]" << endl;
+            cerr << "                       [--sample periodic:<window>:<period>[:<warmup>]|sets:<ratio>]" << endl;
+            cerr << "                       [--load-checkpoint <directory> [--reset-counters]] [--save-checkpoint <directory>]" << endl;
+            cerr << "                       [--stop-after N]" << endl;
+            cerr << "       Cache_Simulator --sweep <hierarchies file> [--threads N]" << endl;
+            return 1;
+        }
+    }
+    if (!sweepFile.empty() && (streamMode || stackDistanceMode)) {
+        cerr << "--sweep loads its trace once for all hierarchies and cannot be combined with --stream or --stack-distance" << endl;
+        return 1;
+    }
+    bool assisted = !prefetchOptions.empty() || !victimCacheOptions.empty();
+    if (assisted && (!sweepFile.empty() || stackDistanceMode)) {
+        cerr << "--prefetch and --victim-cache apply to the interactive hierarchies and cannot be combined with --sweep or --stack-distance" << endl;
+        return 1;
+    }
+    if ((classifyMisses || !profileFile.empty()) && (!sweepFile.empty() || stackDistanceMode)) {
+        cerr << "--classify-misses and --profile apply to the interactive hierarchies and cannot be combined with --sweep or --stack-distance" << endl;
+        return 1;
+    }
+    if (!configFile.empty() && !sweepFile.empty()) {
+        cerr << "--config describes the hierarchies to simulate and cannot be combined with --sweep" << endl;
+        return 1;
+    }
+    if (sampleOption.kind != SAMPLE_NONE &&
+        (schedule == SCHEDULE_INTERLEAVED || schedule == SCHEDULE_PIPELINE || schedule == SCHEDULE_SETS ||
+         verbosity == VERBOSITY_TRACE || assisted || classifyMisses || !profileFile.empty() || !missCacheDir.empty() ||
+         !sweepFile.empty() || stackDistanceMode)) {
+        cerr << "--sample measures part of each trace and runs with --schedule sequential|threads only; it cannot be combined with --verbosity trace, --prefetch, --victim-cache, --classify-misses, --profile, --miss-cache, --sweep or --stack-distance" << endl;
+        return 1;
+    }
+
+    bool checkpointing = !saveCheckpointDir.empty() || !loadCheckpointDir.empty() || stopAfter > 0;
+    if (checkpointing &&
+        (schedule == SCHEDULE_INTERLEAVED || schedule == SCHEDULE_PIPELINE || schedule == SCHEDULE_SETS || assisted ||
+         sampleOption.kind != SAMPLE_NONE || !missCacheDir.empty() || !sweepFile.empty() || stackDistanceMode)) {
+        cerr << "--save-checkpoint, --load-checkpoint and --stop-after run with --schedule sequential|threads only and capture the cache levels alone; they cannot be combined with --prefetch, --victim-cache, --sample, --miss-cache, --sweep or --stack-distance" << endl;
+        return 1;
+    }
+    if (!loadCheckpointDir.empty() && (classifyMisses || !profileFile.empty())) {
+        cerr << "--load-checkpoint restores the cache levels but not the access history --classify-misses and --profile need" << endl;
+        return 1;
+    }
+    if (resetCounters && loadCheckpointDir.empty()) {
+        cerr << "--reset-counters applies to the state of --load-checkpoint" << endl;
+        return 1;
+    }
+
+    // Stored miss streams are written and replayed by the pipelined schedule
+    if (!missCacheDir.empty()) {
+        if (schedule == SCHEDULE_INTERLEAVED || schedule == SCHEDULE_SETS || !sweepFile.empty() || stackDistanceMode ||
+            classifyMisses || !profileFile.empty()) {
+            cerr << "--miss-cache replays levels through the pipelined schedule and cannot be combined with --schedule interleaved|sets, --sweep, --stack-distance, --classify-misses or --profile" << endl;
+            return 1;
+        }
+        schedule = SCHEDULE_PIPELINE;
+    }
+    if (schedule == SCHEDULE_PIPELINE && (verbosity == VERBOSITY_TRACE || assisted || inclusion != INCLUSION_NINE)) {
+        cerr << "--schedule pipeline and --miss-cache only send misses down the levels and cannot be combined with --verbosity trace, --prefetch, --victim-cache or --inclusion inclusive|exclusive" << endl;
+        return 1;
+    }
+    if (schedule == SCHEDULE_SETS && (verbosity == VERBOSITY_TRACE || assisted || classifyMisses || !profileFile.empty())) {
+        cerr << "--schedule sets splits each level's sets across threads and cannot be combined with --verbosity trace, --prefetch, --victim-cache, --classify-misses or --profile" << endl;
+        return 1;
+    }
+    if (!resultsFile.empty() && (!sweepFile.empty() || stackDistanceMode)) {
+        cerr << "--results exports the simulated hierarchies and cannot be combined with --sweep or --stack-distance" << endl;
+        return 1;
+    }
+
+    // A config file replaces the prompts
+    vector<HierarchyConfig> configs;
+    if (!configFile.empty()) {
+        readConfigFile(configFile, configs);
+        if (!loadHierarchies(configs)) {
+            return 1;
+        }
+        stackDistanceMode ? stackDistanceSim(configs) : cacheSim(configs);
+        return 0;
+    }
+
     // Input for memory and cache parameters
     cout << "Enter memory address bits (16 to 40): ";
     cin >> memoryBits;
@@ -306,6 +2873,16 @@ int main() {
         cin >>memAT;
     }
 
+    // Sweep mode takes its hierarchies from the sweep file and only needs the trace
+    if (!sweepFile.empty()) {
+        cout << "Sweep trace file: ";
+        cin >> dataFile;
+        readFile(dataFile, dataMemAdds, dataWrites, TRACE_DATA);
+        cout << endl;
+        sweepSim(sweepFile, dataFile, workerThreads);
+        return 0;
+    }
+
     // Data cache input
     cout << "Enter number of cache levels: ";
     cin >> numLevels_data;
@@ -313,12 +2890,24 @@ int main() {
     cacheSizes_data.resize(numLevels_data);
     cacheLineSizes_data.resize(numLevels_data);
     cacheATs_data.resize(numLevels_data);
+    cacheWays_data.resize(numLevels_data);
+    cachePolicies_data.resize(numLevels_data);
+    cacheWritePolicies_data.resize(numLevels_data);
 
     for (int i = 0; i < numLevels_data; i++) {
         cout << "Level " << i + 1 << " data cache size (bytes): ";
         cin >> cacheSizes_data[i];
         cout << "Level " << i + 1 << " data cache line size (bytes): ";
         cin >> cacheLineSizes_data[i];
+        readOrganization("data", i, static_cast<int>(cacheSizes_data[i] / cacheLineSizes_data[i]),
+                         cacheWays_data[i], cachePolicies_data[i]);
+        string writeName;
+        cout << "Level " << i + 1 << " data cache write policy (WB-WA, WB-NWA, WT-WA, WT-NWA): ";
+        cin >> writeName;
+        while(!parseWritePolicy(writeName, cacheWritePolicies_data[i])){
+            cout << "Invalid input. Please enter WB-WA, WB-NWA, WT-WA or WT-NWA:" << endl;
+            cin >> writeName;
+        }
         cout << "Level " << i + 1 << " data cache access time (1 to 10 cycles): ";
         cin >> cacheATs_data[i];
         while(cacheATs_data[i] < 1 || cacheATs_data[i] > 10){
@@ -333,30 +2922,57 @@ int main() {
     cacheSizes_instr.resize(numLevels_instr);
     cacheLineSizes_instr.resize(numLevels_instr);
     cacheATs_instr.resize(numLevels_instr);
+    cacheWays_instr.resize(numLevels_instr);
+    cachePolicies_instr.resize(numLevels_instr);
 
     for (int i = 0; i < numLevels_instr; i++) {
         cout << "Level " << i + 1 << " instruction cache size (bytes): ";
         cin >> cacheSizes_instr[i];
         cout << "Level " << i + 1 << " instruction cache line size (bytes): ";
         cin >> cacheLineSizes_instr[i];
+        readOrganization("instruction", i, static_cast<int>(cacheSizes_instr[i] / cacheLineSizes_instr[i]),
+                         cacheWays_instr[i], cachePolicies_instr[i]);
         cout << "Level " << i + 1 << " instruction cache access time (1 to 10 cycles): ";
         cin >> cacheATs_instr[i];
     }
 
     // Read memory addresses
-    string instructionFile, dataFile;
     cout << "Instruction memory address file: ";
     cin >> instructionFile;
     cout << "Data memory address file: ";
     cin >> dataFile;
 
-    readFile(instructionFile, instructionMemAdds);
-    readFile(dataFile, dataMemAdds);
+    // The data and instruction hierarchies of the answers above
+    configs.resize(2);
+    configs[0].name = "Data";
+    configs[0].type = TRACE_DATA;
+    configs[0].traceFile = dataFile;
+    configs[0].cacheATs = cacheATs_data;
+    for (int i = 0; i < numLevels_data; i++) {
+        configs[0].levels.push_back(CacheLevel(cacheSizes_data[i], cacheLineSizes_data[i], cacheWays_data[i],
+                                               cachePolicies_data[i], cacheWritePolicies_data[i], memoryBits));
+    }
+    configs[1].name = "Instruction";
+    configs[1].type = TRACE_INSTRUCTION;
+    configs[1].traceFile = instructionFile;
+    configs[1].cacheATs = cacheATs_instr;
+    for (int i = 0; i < numLevels_instr; i++) {
+        configs[1].levels.push_back(CacheLevel(cacheSizes_instr[i], cacheLineSizes_instr[i], cacheWays_instr[i],
+                                               cachePolicies_instr[i], WRITE_BACK_ALLOCATE, memoryBits));
+    }
+    if (!loadHierarchies(configs)) {
+        return 1;
+    }
 
     cout << endl << endl << endl;
 
     // Run the simulation
-    cacheSim();
+    if (stackDistanceMode) {
+        stackDistanceSim(configs);
+    }
+    else {
+        cacheSim(configs);
+    }
 
     return 0;
 }
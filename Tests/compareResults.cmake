@@ -0,0 +1,28 @@
+# Runs SIMULATOR on CONFIG with --schedule sequential, then with FIRST (when given) and OPTIONS, and fails
+# unless the last run writes the same --results file as the sequential one. Options are split like a shell
+# command line; WORK is emptied first and holds the results and anything the options write.
+# cmake -DSIMULATOR=<path> -DCONFIG=<file> -DWORK=<directory> [-DFIRST=<options>] -DOPTIONS=<options> -P compareResults.cmake
+
+file(REMOVE_RECURSE "${WORK}")
+file(MAKE_DIRECTORY "${WORK}")
+
+function(simulate options results)
+    separate_arguments(arguments UNIX_COMMAND "${options}")
+    execute_process(COMMAND "${SIMULATOR}" --config "${CONFIG}" ${arguments} --results "${results}"
+            RESULT_VARIABLE status OUTPUT_QUIET)
+    if (NOT status EQUAL 0)
+        message(FATAL_ERROR "Cache_Simulator ${options} failed (${status})")
+    endif ()
+endfunction()
+
+simulate("--schedule sequential" "${WORK}/sequential.json")
+if (FIRST)
+    simulate("${FIRST}" "${WORK}/first.json")
+endif ()
+simulate("${OPTIONS}" "${WORK}/results.json")
+
+execute_process(COMMAND "${CMAKE_COMMAND}" -E compare_files "${WORK}/sequential.json" "${WORK}/results.json"
+        RESULT_VARIABLE different)
+if (different)
+    message(FATAL_ERROR "Cache_Simulator ${OPTIONS} differs from the sequential run: ${WORK}/results.json")
+endif ()
@@ -0,0 +1,77 @@
+#include "accessProfile.h"
+
+using namespace std;
+
+AccessProfile::AccessProfile(int lineSize, const vector<int>& numSets) : reuse(lineSize) {
+    for (int sets : numSets) {
+        setAccesses.push_back(vector<uint64_t>(sets, 0));
+        setMisses.push_back(vector<uint64_t>(sets, 0));
+    }
+}
+
+vector<uint64_t> AccessProfile::reuseBuckets() const {
+    vector<uint64_t> buckets;
+    const vector<uint64_t>& counts = reuse.histogram();
+    for (size_t distance = 0; distance < counts.size(); distance++) {
+        size_t bucket = 0;
+        while ((distance >> bucket) != 0) {
+            bucket++;
+        }
+        if (bucket >= buckets.size()) {
+            buckets.resize(bucket + 1, 0);
+        }
+        buckets[bucket] += counts[distance];
+    }
+    return buckets;
+}
+
+// Smallest and largest distance of a bucket
+static uint64_t bucketFrom(size_t bucket) { return bucket == 0 ? 0 : 1ULL << (bucket - 1); }
+static uint64_t bucketTo(size_t bucket) { return bucket == 0 ? 0 : (1ULL << bucket) - 1; }
+
+void AccessProfile::writeCsvHeader(ostream& out) {
+    out << "cache,table,level,bin,accesses,misses\n";
+}
+
+void AccessProfile::writeCsv(ostream& out, const string& cache) const {
+    vector<uint64_t> buckets = reuseBuckets();
+    for (size_t bucket = 0; bucket < buckets.size(); bucket++) {
+        out << cache << ",reuse,1," << bucketFrom(bucket) << "," << buckets[bucket] << ",\n";
+    }
+    out << cache << ",reuse,1,cold," << coldAccesses() << ",\n";
+    for (size_t level = 0; level < setAccesses.size(); level++) {
+        for (size_t index = 0; index < setAccesses[level].size(); index++) {
+            out << cache << ",sets," << level + 1 << "," << index << "," << setAccesses[level][index] << ","
+                << setMisses[level][index] << "\n";
+        }
+    }
+}
+
+// Writes values as a JSON array
+static void writeJsonArray(ostream& out, const vector<uint64_t>& values) {
+    out << "[";
+    for (size_t i = 0; i < values.size(); i++) {
+        out << (i > 0 ? "," : "") << values[i];
+    }
+    out << "]";
+}
+
+void AccessProfile::writeJson(ostream& out) const {
+    out << "{\n    \"lineSize\": " << reuse.lineSize() << ",\n    \"reuseDistance\": {\n        \"cold\": "
+        << coldAccesses() << ",\n        \"buckets\": [";
+    vector<uint64_t> buckets = reuseBuckets();
+    for (size_t bucket = 0; bucket < buckets.size(); bucket++) {
+        out << (bucket > 0 ? "," : "") << "\n            {\"from\": " << bucketFrom(bucket) << ", \"to\": "
+            << bucketTo(bucket) << ", \"count\": " << buckets[bucket] << "}";
+    }
+    out << "\n        ]\n    },\n    \"levels\": [";
+    for (size_t level = 0; level < setAccesses.size(); level++) {
+        out << (level > 0 ? "," : "") << "\n        {\"level\": " << level + 1 << ", \"sets\": "
+            << setAccesses[level].size() << ",\n         \"accesses\": ";
+        writeJsonArray(out, setAccesses[level]);
+        out << ",\n         \"misses\": ";
+        writeJsonArray(out, setMisses[level]);
+        out << "}";
+    }
+    out << "\n    ]\n  }";
+}
@@ -0,0 +1,47 @@
+#ifndef CACHE_SIMULATOR_ACCESSPROFILE_H
+#define CACHE_SIMULATOR_ACCESSPROFILE_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "stackDistance.h"
+
+// Where one hierarchy's accesses go, for choosing sizes and index functions without sweeping them:
+//   reuse distance  per access of the trace, the distinct lines touched since the previous access to its
+//                   line (in level 1 lines), in log2 buckets: 0, 1, 2-3, 4-7, ... and cold first touches
+//   set pressure    per level and index, the accesses that reached the set and how many of them missed
+class AccessProfile {
+public:
+    AccessProfile() : reuse(1) {}
+    AccessProfile(int lineSize, const std::vector<int>& numSets);
+
+    // An access of the trace, before it reaches any level
+    void access(uint64_t address) { reuse.access(address); }
+
+    // An access reaching index of level, a hit or a miss there
+    void record(int level, int index, bool hit) {
+        setAccesses[level][index]++;
+        if (!hit) {
+            setMisses[level][index]++;
+        }
+    }
+
+    // Reuse distances per bucket: bucket 0 holds distance 0, bucket b distances 2^(b-1) to 2^b - 1
+    std::vector<uint64_t> reuseBuckets() const;
+    uint64_t coldAccesses() const { return reuse.coldMisses(); }
+
+    // Both tables as rows of cache,table,level,bin,accesses,misses. Reuse rows have level 1 and the bucket's
+    // smallest distance (or "cold") as bin, with the count as accesses; set rows have the index as bin.
+    static void writeCsvHeader(std::ostream& out);
+    void writeCsv(std::ostream& out, const std::string& cache) const;
+
+    // Both tables as the JSON object of one cache
+    void writeJson(std::ostream& out) const;
+
+private:
+    StackDistanceAnalyzer reuse;
+    std::vector<std::vector<uint64_t> > setAccesses, setMisses; // Per level, per index
+};
+
+#endif //CACHE_SIMULATOR_ACCESSPROFILE_H
@@ -0,0 +1,223 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "cacheLevel.h"
+#include "stackDistance.h"
+#include "traceReader.h"
+
+using namespace std;
+
+// Microbenchmark of the per-access level walk without any tracing output:
+// today's division-based loop against the CacheLevel address split engine.
+
+// Line layout cacheSim() used before the structure-of-arrays tag store
+struct CacheLine {
+    bool VB = false; // Valid bit
+    int64_t tag = -1; // Cache tag
+};
+
+// Division-based walk as cacheSim() used to do it: line count and index/tag recomputed per level
+long long divisionLoop(const vector<uint64_t>& memAdds, const vector<int>& sizes, const vector<int>& lineSizes,
+                       vector<vector<CacheLine> >& caches) {
+    long long hits = 0;
+    int numLevels = sizes.size();
+    for (uint64_t address : memAdds) {
+        for (int level = 0; level < numLevels; level++) {
+            int cacheLines = sizes[level] / lineSizes[level];
+            int index = static_cast<int>((address / lineSizes[level]) % cacheLines);
+            int64_t tag = static_cast<int64_t>((address / lineSizes[level]) / cacheLines);
+            CacheLine& line = caches[level][index];
+            if (line.VB && line.tag == tag) {
+                hits++;
+                break;
+            }
+            line.VB = true;
+            line.tag = tag;
+        }
+    }
+    return hits;
+}
+
+// Same walk on CacheLevel through find/touch/fill, with the split chosen at compile time
+template <bool PowerOfTwo>
+long long engineLoop(const vector<uint64_t>& memAdds, vector<CacheLevel>& caches) {
+    long long hits = 0;
+    int numLevels = caches.size();
+    for (uint64_t address : memAdds) {
+        for (int level = 0; level < numLevels; level++) {
+            int set;
+            int64_t tag;
+            caches[level].locate<PowerOfTwo>(address, set, tag);
+            int way = caches[level].find(set, tag);
+            if (way >= 0) {
+                caches[level].touch(set, way);
+                hits++;
+                break;
+            }
+            caches[level].fill(set, tag);
+        }
+    }
+    return hits;
+}
+
+// Probe-only comparison of one full 16-way level: a scalar scan over array-of-structs lines against
+// CacheLevel::find on the structure-of-arrays tags
+long long probeAos(const vector<uint64_t>& memAdds, const vector<CacheLine>& lines, const CacheLevel& shape) {
+    long long hits = 0;
+    for (uint64_t address : memAdds) {
+        int set;
+        int64_t tag;
+        shape.locate<true>(address, set, tag);
+        const CacheLine* first = &lines[static_cast<size_t>(set) * shape.ways];
+        for (int way = 0; way < shape.ways; way++) {
+            if (first[way].VB && first[way].tag == tag) {
+                hits++;
+                break;
+            }
+        }
+    }
+    return hits;
+}
+
+long long probeSoa(const vector<uint64_t>& memAdds, const CacheLevel& cache) {
+    long long hits = 0;
+    for (uint64_t address : memAdds) {
+        int set;
+        int64_t tag;
+        cache.locate<true>(address, set, tag);
+        hits += cache.find(set, tag) >= 0;
+    }
+    return hits;
+}
+
+// Runs one variant on a fresh set of levels and prints its throughput
+template <typename Run>
+void report(const string& name, size_t accesses, Run run) {
+    auto start = chrono::steady_clock::now();
+    long long hits = run();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << left << setw(28) << name
+        << setw(16) << fixed << setprecision(1) << accesses / seconds / 1e6
+        << setw(12) << setprecision(3) << seconds
+        << hits << endl;
+}
+
+int main(int argc, char* argv[]) {
+    // Cache_Benchmark [trace file] [size:lineSize ...], defaults to a synthetic 20M access trace
+    // through a 32 KB / 256 KB / 2 MB hierarchy with 64-byte lines
+    vector<uint64_t> memAdds;
+    vector<int> sizes, lineSizes;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        size_t colon = arg.find(':');
+        if (colon != string::npos) {
+            sizes.push_back(atoi(arg.substr(0, colon).c_str()));
+            lineSizes.push_back(atoi(arg.substr(colon + 1).c_str()));
+        }
+        else {
+            vector<bool> writes; // The kernels only model reads
+            ParseStats stats;
+            string error;
+            if (!loadTrace(arg, memAdds, writes, stats, error)) {
+                cerr << "Error reading file: " << arg << " (" << error << ")" << endl;
+                return 1;
+            }
+        }
+    }
+    if (sizes.empty()) {
+        sizes = {32768, 262144, 2097152};
+        lineSizes = {64, 64, 64};
+    }
+    if (memAdds.empty()) {
+        // Mostly sequential sweeps with occasional random jumps, like the Tests/ traces at scale
+        mt19937 random(42);
+        uint64_t address = 0;
+        for (int i = 0; i < 20000000; i++) {
+            address = random() % 10 == 0 ? random() % (1 << 28) : (address + 16) % (1 << 28);
+            memAdds.push_back(address);
+        }
+    }
+
+    cout << "Accesses: " << memAdds.size() << ", levels:";
+    for (size_t i = 0; i < sizes.size(); i++) {
+        cout << " " << sizes[i] << "/" << lineSizes[i];
+    }
+    cout << endl << endl;
+    cout << left << setw(28) << "Variant" << setw(16) << "M accesses/s" << setw(12) << "Seconds" << "Hits" << endl;
+
+    report("division (old cacheSim)", memAdds.size(), [&]() {
+        vector<vector<CacheLine> > caches;
+        for (size_t i = 0; i < sizes.size(); i++) {
+            caches.push_back(vector<CacheLine>(sizes[i] / lineSizes[i]));
+        }
+        return divisionLoop(memAdds, sizes, lineSizes, caches);
+    });
+
+    vector<CacheLevel> caches;
+    for (size_t i = 0; i < sizes.size(); i++) {
+        caches.push_back(CacheLevel(sizes[i], lineSizes[i]));
+    }
+    report("CacheLevel<division>", memAdds.size(), [&]() {
+        vector<CacheLevel> fresh = caches;
+        return engineLoop<false>(memAdds, fresh);
+    });
+    if (allPowerOfTwo(caches)) {
+        report("CacheLevel<shift/mask>", memAdds.size(), [&]() {
+            vector<CacheLevel> fresh = caches;
+            return engineLoop<true>(memAdds, fresh);
+        });
+    }
+
+    // The same hierarchy with 8-way levels and every replacement policy
+    for (int policy = POLICY_LRU; policy <= POLICY_RANDOM; policy++) {
+        vector<CacheLevel> associative;
+        for (size_t i = 0; i < sizes.size(); i++) {
+            associative.push_back(CacheLevel(sizes[i], lineSizes[i], 8, static_cast<ReplacementPolicy>(policy)));
+        }
+        string name = string("8-way ") + policyName(static_cast<ReplacementPolicy>(policy));
+        report(name, memAdds.size(), [&]() {
+            return allPowerOfTwo(associative) ? engineLoop<true>(memAdds, associative)
+                                              : engineLoop<false>(memAdds, associative);
+        });
+    }
+
+    // And a 16-way last level, where replacement and lookup cost the most
+    for (int policy = POLICY_LRU; policy <= POLICY_RANDOM; policy++) {
+        vector<CacheLevel> llc;
+        llc.push_back(CacheLevel(sizes.back(), lineSizes.back(), 16, static_cast<ReplacementPolicy>(policy)));
+        string name = string("16-way LLC ") + policyName(static_cast<ReplacementPolicy>(policy));
+        report(name, memAdds.size(), [&]() {
+            return allPowerOfTwo(llc) ? engineLoop<true>(memAdds, llc) : engineLoop<false>(memAdds, llc);
+        });
+    }
+
+    // Lookup alone on a warmed 16-way 2 MB level, the hottest path of large associative levels
+    CacheLevel warmed(2097152, 64, 16);
+    vector<CacheLine> lines(warmed.numLines);
+    for (uint64_t address : memAdds) {
+        int set;
+        int64_t tag;
+        warmed.locate<true>(address, set, tag);
+        if (warmed.find(set, tag) < 0) {
+            int way = warmed.fill(set, tag);
+            lines[static_cast<size_t>(set) * warmed.ways + way].VB = true;
+            lines[static_cast<size_t>(set) * warmed.ways + way].tag = tag;
+        }
+    }
+    report("16-way probe, scalar AoS", memAdds.size(), [&]() { return probeAos(memAdds, lines, warmed); });
+    report("16-way probe, SIMD SoA", memAdds.size(), [&]() { return probeSoa(memAdds, warmed); });
+
+    // One stack-distance pass, which yields the hits of every fully-associative LRU size at once
+    report("stack distance, all sizes", memAdds.size(), [&]() {
+        StackDistanceAnalyzer analyzer(lineSizes.front());
+        for (uint64_t address : memAdds) {
+            analyzer.access(address);
+        }
+        return static_cast<long long>(analyzer.hits(sizes.front() / lineSizes.front()));
+    });
+    return 0;
+}
@@ -0,0 +1,443 @@
+#ifndef CACHE_SIMULATOR_CACHELEVEL_H
+#define CACHE_SIMULATOR_CACHELEVEL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "replacementPolicy.h"
+#include "tagArena.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+const int64_t TAG_INVALID = -1; // Tag reported for invalid lines, never equal to an address tag
+const int SIMD_BYTES = 16; // Associative sets are padded to a multiple of this many bytes of tags
+const int SHARD_SETS = 64; // Sets whose dirty bits and replacement state fill whole words, so threads can own them apart
+
+// Bitmask of the lanes of tags[0, count) equal to tag: one AVX2 compare covers 32 bytes of tags, one SSE2
+// compare 16 bytes, and a scalar loop handles whatever is left (or everything, without vector extensions).
+// Tags are 16, 32 or 64 bits wide, whichever is the narrowest that holds a level's tags.
+inline uint64_t matchTags(const int16_t* tags, int count, int16_t tag) {
+    uint64_t mask = 0;
+    int i = 0;
+#if defined(__AVX2__)
+    __m256i wide = _mm256_set1_epi16(tag);
+    for (; i + 16 <= count; i += 16) {
+        __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tags + i));
+        // Packing narrows each lane to a byte, within the two 128-bit halves
+        __m256i equal = _mm256_packs_epi16(_mm256_cmpeq_epi16(lanes, wide), _mm256_setzero_si256());
+        unsigned bits = static_cast<unsigned>(_mm256_movemask_epi8(equal));
+        mask |= static_cast<uint64_t>((bits & 0xFF) | (bits >> 8 & 0xFF00)) << i;
+    }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+    __m128i narrow = _mm_set1_epi16(tag);
+    for (; i + 8 <= count; i += 8) {
+        __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tags + i));
+        __m128i equal = _mm_packs_epi16(_mm_cmpeq_epi16(lanes, narrow), _mm_setzero_si128());
+        mask |= static_cast<uint64_t>(static_cast<unsigned>(_mm_movemask_epi8(equal)) & 0xFF) << i;
+    }
+#endif
+    for (; i < count; i++) {
+        if (tags[i] == tag) {
+            mask |= 1ULL << i;
+        }
+    }
+    return mask;
+}
+
+inline uint64_t matchTags(const int32_t* tags, int count, int32_t tag) {
+    uint64_t mask = 0;
+    int i = 0;
+#if defined(__AVX2__)
+    __m256i wide = _mm256_set1_epi32(tag);
+    for (; i + 8 <= count; i += 8) {
+        __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tags + i));
+        unsigned bits = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(lanes, wide))));
+        mask |= static_cast<uint64_t>(bits) << i;
+    }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+    __m128i narrow = _mm_set1_epi32(tag);
+    for (; i + 4 <= count; i += 4) {
+        __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tags + i));
+        unsigned bits = static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(lanes, narrow))));
+        mask |= static_cast<uint64_t>(bits) << i;
+    }
+#endif
+    for (; i < count; i++) {
+        if (tags[i] == tag) {
+            mask |= 1ULL << i;
+        }
+    }
+    return mask;
+}
+
+inline uint64_t matchTags(const int64_t* tags, int count, int64_t tag) {
+    uint64_t mask = 0;
+    int i = 0;
+#if defined(__AVX2__)
+    __m256i wide = _mm256_set1_epi64x(tag);
+    for (; i + 4 <= count; i += 4) {
+        __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tags + i));
+        unsigned bits = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(lanes, wide))));
+        mask |= static_cast<uint64_t>(bits) << i;
+    }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+    __m128i narrow = _mm_set1_epi64x(tag);
+    for (; i + 2 <= count; i += 2) {
+        __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tags + i));
+        // SSE2 has no 64-bit compare: a lane matches when both of its 32-bit halves do
+        __m128i halves = _mm_cmpeq_epi32(lanes, narrow);
+        __m128i equal = _mm_and_si128(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)));
+        unsigned bits = static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(equal)));
+        mask |= static_cast<uint64_t>(bits) << i;
+    }
+#endif
+    for (; i < count; i++) {
+        if (tags[i] == tag) {
+            mask |= 1ULL << i;
+        }
+    }
+    return mask;
+}
+
+// How a level handles writes. Write-back keeps a written line dirty until it is evicted, write-through
+// passes every write on to the level below; write-allocate brings a missing line in before writing it,
+// no-write-allocate sends the write down without filling.
+enum WritePolicy {
+    WRITE_BACK_ALLOCATE,
+    WRITE_BACK_NO_ALLOCATE,
+    WRITE_THROUGH_ALLOCATE,
+    WRITE_THROUGH_NO_ALLOCATE
+};
+
+inline const char* writePolicyName(WritePolicy policy) {
+    switch (policy) {
+        case WRITE_BACK_ALLOCATE: return "WB-WA";
+        case WRITE_BACK_NO_ALLOCATE: return "WB-NWA";
+        case WRITE_THROUGH_ALLOCATE: return "WT-WA";
+        case WRITE_THROUGH_NO_ALLOCATE: return "WT-NWA";
+    }
+    return "?";
+}
+
+// Accepts the names printed by writePolicyName(), case-insensitively
+inline bool parseWritePolicy(std::string name, WritePolicy& policy) {
+    for (char& c : name) {
+        c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+    }
+    for (int i = WRITE_BACK_ALLOCATE; i <= WRITE_THROUGH_NO_ALLOCATE; i++) {
+        if (name == writePolicyName(static_cast<WritePolicy>(i))) {
+            policy = static_cast<WritePolicy>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// One cache level: sets of ways lines each (one way is direct-mapped), its replacement state, and
+// the address split, precomputed once per configuration. Lines are stored as a structure of arrays:
+// the tags of a set sit next to each other so one vector compare probes several ways, and the valid
+// bit is folded into the tag: a lane holds tag + 1, and 0 for an invalid line. The tag width follows
+// from the address width and the geometry, and tags are kept in the narrowest of 16, 32 or 64-bit lanes
+// that holds it, so large caches of small address spaces stay compact and wide address spaces still fit.
+// Tags and dirty bits share one TagArena; an empty level is all zeros, so a GB-scale level costs no
+// initializing pass and only the pages its sets reach.
+struct CacheLevel {
+    int64_t size = 0; // Cache size in bytes
+    int lineSize = 0; // Line size in bytes
+    int numLines = 0; // size / lineSize
+    int ways = 1; // Lines per set
+    int numSets = 0; // numLines / ways, the range of the index
+
+    // Shift/mask form of the split, only meaningful when powerOfTwo is set
+    bool powerOfTwo = false; // Line size and set count are both powers of two
+    int offsetBits = 0;
+    int indexBits = 0;
+    unsigned indexMask = 0;
+
+    int tagBits = 0; // Bits of the largest stored lane value, tag + 1, an address of the address space can have
+    int tagBytes = 4; // Width of the tag lanes: 2, 4 or 8 bytes
+    int tagStride = 1; // Tags per set: ways, padded to SIMD_BYTES for associative sets
+
+    // Set-major tag lanes, then a bit per line (set * ways + way) marking it dirty
+    TagArena store;
+    size_t dirtyOffset = 0; // Byte offset of the dirty bits in store
+    uint64_t waysMask = 1; // Low ways bits set
+    PolicyState replacement;
+
+    bool writeBack = true; // Otherwise write-through
+    bool writeAllocate = true;
+
+    CacheLevel(int64_t size, int lineSize, int ways = 1, ReplacementPolicy policy = POLICY_LRU,
+               WritePolicy write = WRITE_BACK_ALLOCATE, int addressBits = 32)
+        : size(size), lineSize(lineSize), numLines(static_cast<int>(size / lineSize)), ways(ways), numSets(numLines / ways),
+          writeBack(write == WRITE_BACK_ALLOCATE || write == WRITE_BACK_NO_ALLOCATE),
+          writeAllocate(write == WRITE_BACK_ALLOCATE || write == WRITE_THROUGH_ALLOCATE) {
+        powerOfTwo = isPowerOfTwo(lineSize) && isPowerOfTwo(numSets);
+        if (powerOfTwo) {
+            offsetBits = log2Of(lineSize);
+            indexBits = log2Of(numSets);
+            indexMask = static_cast<unsigned>(numSets) - 1;
+        }
+
+        uint64_t maxLane = (addressBits >= 64 ? ~0ULL : (1ULL << addressBits) - 1) / lineSize / numSets + 1;
+        while (tagBits < 64 && (maxLane >> tagBits) != 0) {
+            tagBits++;
+        }
+        tagBytes = tagBits < 16 ? 2 : (tagBits < 32 ? 4 : 8); // Lanes are signed, so the sign bit stays clear
+        int lanes = SIMD_BYTES / tagBytes;
+        tagStride = ways == 1 ? 1 : (ways + lanes - 1) / lanes * lanes;
+        size_t tagSpace = static_cast<size_t>(numSets) * tagStride * tagBytes;
+        dirtyOffset = (tagSpace + 7) / 8 * 8;
+        store = TagArena(dirtyOffset + (static_cast<size_t>(numLines) + 63) / 64 * 8);
+        waysMask = ways == 64 ? ~0ULL : (1ULL << ways) - 1;
+        replacement.init(policy, numSets, ways);
+    }
+
+    template <typename Tag>
+    const Tag* lanes() const { return reinterpret_cast<const Tag*>(store.data()); }
+    template <typename Tag>
+    Tag* writableLanes() { return reinterpret_cast<Tag*>(store.writable()); }
+    const uint64_t* dirtyWords() const { return reinterpret_cast<const uint64_t*>(store.data() + dirtyOffset); }
+    uint64_t* writableDirtyWords() { return reinterpret_cast<uint64_t*>(store.writable() + dirtyOffset); }
+
+    int64_t tagOf(int set, int way) const {
+        size_t slot = static_cast<size_t>(set) * tagStride + way;
+        switch (tagBytes) {
+            case 2: return lanes<int16_t>()[slot] - 1;
+            case 4: return lanes<int32_t>()[slot] - 1;
+            default: return lanes<int64_t>()[slot] - 1;
+        }
+    }
+
+    bool isValid(int set, int way) const { return tagOf(set, way) != TAG_INVALID; }
+
+    // Whether any way of set holds a line: invalid and padding lanes are zero
+    bool holdsLines(int set) const {
+        size_t bytes = static_cast<size_t>(tagStride) * tagBytes;
+        const char* lanes = store.data() + set * bytes;
+        char any = 0;
+        for (size_t i = 0; i < bytes; i++) {
+            any |= lanes[i];
+        }
+        return any != 0;
+    }
+
+    // Readies the level for threads filling disjoint blocks of SHARD_SETS sets at once: the tag store and the
+    // policy state are flagged as written up front, so the threads write to nothing but their own sets.
+    // Policies with state shared by all sets (RANDOM and BRRIP) cannot be split this way.
+    bool prepareShards() {
+        if (ways > 1 && (replacement.policy == POLICY_RANDOM || replacement.policy == POLICY_BRRIP)) {
+            return false;
+        }
+        store.writable();
+        replacement.writableWords();
+        return true;
+    }
+
+    // The tag store is big enough to live in huge pages, so the OS backs only the parts a trace reaches
+    bool sparse() const { return store.hugePages(); }
+    bool isDirty(int set, int way) const {
+        size_t line = static_cast<size_t>(set) * ways + way;
+        return (dirtyWords()[line >> 6] >> (line & 63) & 1) != 0;
+    }
+    void markDirty(int set, int way) {
+        size_t line = static_cast<size_t>(set) * ways + way;
+        writableDirtyWords()[line >> 6] |= 1ULL << (line & 63);
+    }
+    void clearDirty(int set, int way) {
+        size_t line = static_cast<size_t>(set) * ways + way;
+        writableDirtyWords()[line >> 6] &= ~(1ULL << (line & 63));
+    }
+
+    WritePolicy writePolicy() const {
+        return writeBack ? (writeAllocate ? WRITE_BACK_ALLOCATE : WRITE_BACK_NO_ALLOCATE)
+                         : (writeAllocate ? WRITE_THROUGH_ALLOCATE : WRITE_THROUGH_NO_ALLOCATE);
+    }
+
+    // Way of set holding tag, or -1 on a miss
+    int find(int set, int64_t tag) const {
+        switch (tagBytes) {
+            case 2: return findLane<int16_t>(set, static_cast<int16_t>(tag + 1));
+            case 4: return findLane<int32_t>(set, static_cast<int32_t>(tag + 1));
+            default: return findLane<int64_t>(set, tag + 1);
+        }
+    }
+
+    template <typename Tag>
+    int findLane(int set, Tag lane) const {
+        const Tag* setTags = lanes<Tag>() + static_cast<size_t>(set) * tagStride;
+        if (ways == 1) {
+            return setTags[0] == lane ? 0 : -1;
+        }
+        uint64_t hits = matchTags(setTags, tagStride, lane);
+        return hits != 0 ? lowestBit(hits) : -1;
+    }
+
+    // Way a fill of set would replace: the first invalid way, otherwise the policy's victim
+    int victim(int set) const {
+        if (ways == 1) {
+            return 0;
+        }
+        size_t first = static_cast<size_t>(set) * tagStride;
+        uint64_t invalid;
+        switch (tagBytes) {
+            case 2: invalid = matchTags(lanes<int16_t>() + first, tagStride, static_cast<int16_t>(0)); break;
+            case 4: invalid = matchTags(lanes<int32_t>() + first, tagStride, 0); break;
+            default: invalid = matchTags(lanes<int64_t>() + first, tagStride, static_cast<int64_t>(0)); break;
+        }
+        invalid &= waysMask;
+        if (invalid != 0) {
+            return lowestBit(invalid);
+        }
+        return replacement.victim(set);
+    }
+
+    // Stores tag (TAG_INVALID to empty the way) in way of set and returns the tag it replaces
+    int64_t replaceTag(int set, int way, int64_t tag) {
+        return replaceLane(set, way, tag + 1) - 1;
+    }
+
+    int64_t replaceLane(int set, int way, int64_t lane) {
+        size_t slot = static_cast<size_t>(set) * tagStride + way;
+        int64_t old;
+        switch (tagBytes) {
+            case 2: {
+                int16_t* tags = writableLanes<int16_t>();
+                old = tags[slot];
+                tags[slot] = static_cast<int16_t>(lane);
+                break;
+            }
+            case 4: {
+                int32_t* tags = writableLanes<int32_t>();
+                old = tags[slot];
+                tags[slot] = static_cast<int32_t>(lane);
+                break;
+            }
+            default: {
+                int64_t* tags = writableLanes<int64_t>();
+                old = tags[slot];
+                tags[slot] = lane;
+                break;
+            }
+        }
+        return old;
+    }
+
+    // Records a hit on way for the replacement policy
+    void touch(int set, int way) {
+        if (ways > 1) {
+            replacement.touch(set, way);
+        }
+    }
+
+    // Places tag in set, replacing the victim way, and returns the way used
+    int fill(int set, int64_t tag) {
+        int64_t evicted;
+        bool evictedDirty;
+        return fill(set, tag, evicted, evictedDirty);
+    }
+
+    // Same, also giving the tag the way held before (TAG_INVALID if it was free) and whether it was dirty.
+    // The new line starts clean.
+    int fill(int set, int64_t tag, int64_t& evicted, bool& evictedDirty) {
+        int way = victim(set);
+        evicted = replaceTag(set, way, tag);
+        evictedDirty = isDirty(set, way);
+        clearDirty(set, way);
+        if (ways > 1) {
+            replacement.insert(set, way, evicted != TAG_INVALID);
+        }
+        return way;
+    }
+
+    // Drops the line in way, which becomes the set's first choice for the next fill; returns whether it
+    // was dirty
+    bool invalidate(int set, int way) {
+        bool wasDirty = isDirty(set, way);
+        clearDirty(set, way);
+        replaceTag(set, way, TAG_INVALID);
+        return wasDirty;
+    }
+
+    // First address of the line with this set and tag, the inverse of locate
+    uint64_t blockAddress(int set, int64_t tag) const {
+        return (static_cast<uint64_t>(tag) * numSets + set) * lineSize;
+    }
+
+    // Splits an address into set index and tag. The PowerOfTwo instantiation replaces the divisions
+    // and modulo with shifts and a mask; callers only pick it when powerOfTwo is set.
+    template <bool PowerOfTwo>
+    void locate(uint64_t address, int& index, int64_t& tag) const {
+        if (PowerOfTwo) {
+            uint64_t block = address >> offsetBits;
+            index = static_cast<int>(block & indexMask);
+            tag = static_cast<int64_t>(block >> indexBits);
+        }
+        else {
+            uint64_t block = address / static_cast<unsigned>(lineSize);
+            index = static_cast<int>(block % static_cast<unsigned>(numSets));
+            tag = static_cast<int64_t>(block / static_cast<unsigned>(numSets));
+        }
+    }
+
+    static bool isPowerOfTwo(int value) {
+        return value > 0 && (value & (value - 1)) == 0;
+    }
+
+    static int log2Of(int value) {
+        int bits = 0;
+        while ((1 << bits) < value) {
+            bits++;
+        }
+        return bits;
+    }
+};
+
+// Where a hierarchy keeps the lines it brings in from memory:
+// NINE fills every level that missed and lets each evict on its own (non-inclusive non-exclusive),
+// inclusive does the same but invalidates lines in the levels above whenever a lower level evicts them,
+// exclusive fills level 1 only and moves each level's victim down one level
+enum InclusionPolicy {
+    INCLUSION_NINE,
+    INCLUSION_INCLUSIVE,
+    INCLUSION_EXCLUSIVE
+};
+
+inline const char* inclusionName(InclusionPolicy inclusion) {
+    switch (inclusion) {
+        case INCLUSION_NINE: return "nine";
+        case INCLUSION_INCLUSIVE: return "inclusive";
+        case INCLUSION_EXCLUSIVE: return "exclusive";
+    }
+    return "?";
+}
+
+// Accepts the names printed by inclusionName()
+inline bool parseInclusion(const std::string& name, InclusionPolicy& inclusion) {
+    for (int i = INCLUSION_NINE; i <= INCLUSION_EXCLUSIVE; i++) {
+        if (name == inclusionName(static_cast<InclusionPolicy>(i))) {
+            inclusion = static_cast<InclusionPolicy>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// True when every level can use the shift/mask address split
+inline bool allPowerOfTwo(const std::vector<CacheLevel>& levels) {
+    for (const CacheLevel& level : levels) {
+        if (!level.powerOfTwo) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif //CACHE_SIMULATOR_CACHELEVEL_H
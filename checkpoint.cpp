@@ -0,0 +1,190 @@
+#include "checkpoint.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+static void putWord(vector<char>& buffer, uint64_t value) {
+    char bytes[8];
+    memcpy(bytes, &value, 8);
+    buffer.insert(buffer.end(), bytes, bytes + 8);
+}
+
+static bool getWord(ifstream& file, uint64_t& value) {
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), 8));
+}
+
+static uint64_t alignCheckpoint(uint64_t offset) {
+    return (offset + CHECKPOINT_ALIGN - 1) / CHECKPOINT_ALIGN * CHECKPOINT_ALIGN;
+}
+
+// Writes an arena's image at offset, one write per run of pages holding anything but zeros
+static void writeImage(ofstream& file, const TagArena& arena, uint64_t offset) {
+    static const char zeros[CHECKPOINT_PAGE] = {};
+    size_t at = 0;
+    while (at < arena.size()) {
+        size_t start = at;
+        while (at < arena.size() && memcmp(arena.data() + at, zeros, min(CHECKPOINT_PAGE, arena.size() - at)) != 0) {
+            at += CHECKPOINT_PAGE;
+        }
+        if (at > start) {
+            file.seekp(static_cast<streamoff>(offset + start));
+            file.write(arena.data() + start, static_cast<streamsize>(min(at, arena.size()) - start));
+        }
+        at += CHECKPOINT_PAGE;
+    }
+}
+
+bool saveCheckpoint(const string& filePath, const string& key, const vector<CacheLevel>& levels,
+                    const CheckpointCounters& counters, string& error) {
+    vector<char> header(CHECKPOINT_MAGIC, CHECKPOINT_MAGIC + 4);
+    header.resize(8);
+    memcpy(header.data() + 4, &CHECKPOINT_VERSION, 4);
+    putWord(header, key.size());
+    header.insert(header.end(), key.begin(), key.end());
+    putWord(header, counters.position);
+    putWord(header, counters.accesses);
+    putWord(header, static_cast<uint64_t>(counters.memoryReadBytes));
+    putWord(header, static_cast<uint64_t>(counters.memoryWriteBytes));
+    putWord(header, levels.size());
+
+    // Images go after the header, so their offsets are filled in once its size is known
+    vector<const TagArena*> images;
+    vector<size_t> offsetSlots;
+    for (size_t level = 0; level < levels.size(); level++) {
+        const CacheLevel& cache = levels[level];
+        putWord(header, static_cast<uint64_t>(counters.hits[level]));
+        putWord(header, static_cast<uint64_t>(counters.misses[level]));
+        putWord(header, static_cast<uint64_t>(counters.writebacks[level]));
+        putWord(header, static_cast<uint64_t>(counters.writeThroughs[level]));
+        putWord(header, static_cast<uint64_t>(counters.trafficBytes[level]));
+        putWord(header, cache.replacement.random);
+        putWord(header, cache.replacement.fills);
+        for (const TagArena* arena : {&cache.store, &cache.replacement.arena}) {
+            putWord(header, arena->size());
+            offsetSlots.push_back(header.size());
+            putWord(header, 0);
+            images.push_back(arena);
+        }
+    }
+    vector<uint64_t> offsets;
+    uint64_t end = alignCheckpoint(header.size());
+    for (size_t i = 0; i < images.size(); i++) {
+        offsets.push_back(end);
+        memcpy(header.data() + offsetSlots[i], &end, 8);
+        end = alignCheckpoint(end + images[i]->size());
+    }
+
+    string temporary = filePath + ".tmp";
+    ofstream file(temporary, ios::binary | ios::trunc);
+    if (!file) {
+        error = "cannot create file";
+        return false;
+    }
+    file.write(header.data(), static_cast<streamsize>(header.size()));
+    for (size_t i = 0; i < images.size(); i++) {
+        writeImage(file, *images[i], offsets[i]);
+    }
+    file.seekp(static_cast<streamoff>(end));
+    file.write(CHECKPOINT_MAGIC, 4);
+    file.close();
+    if (file.fail()) {
+        error = "write failed";
+        remove(temporary.c_str());
+        return false;
+    }
+    remove(filePath.c_str());
+    if (rename(temporary.c_str(), filePath.c_str()) != 0) {
+        error = "cannot move the checkpoint into place";
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool loadCheckpoint(const string& filePath, const string& key, vector<CacheLevel>& levels,
+                    CheckpointCounters& counters, string& error) {
+    ifstream file(filePath, ios::binary);
+    if (!file) {
+        error = "cannot open file";
+        return false;
+    }
+    char magic[4];
+    uint32_t version = 0;
+    uint64_t keyLength;
+    if (!file.read(magic, 4) || memcmp(magic, CHECKPOINT_MAGIC, 4) != 0 ||
+        !file.read(reinterpret_cast<char*>(&version), 4) || version != CHECKPOINT_VERSION ||
+        !getWord(file, keyLength) || keyLength > (1 << 20)) {
+        error = "not a checkpoint of this version";
+        return false;
+    }
+    string stored(keyLength, '\0');
+    if (!file.read(&stored[0], static_cast<streamsize>(keyLength)) || stored != key) {
+        error = "taken of another trace or with other cache settings";
+        return false;
+    }
+
+    uint64_t memoryRead, memoryWritten, numLevels;
+    if (!getWord(file, counters.position) || !getWord(file, counters.accesses) || !getWord(file, memoryRead) ||
+        !getWord(file, memoryWritten) || !getWord(file, numLevels) || numLevels != levels.size()) {
+        error = "truncated or corrupt checkpoint";
+        return false;
+    }
+    counters.memoryReadBytes = static_cast<long long>(memoryRead);
+    counters.memoryWriteBytes = static_cast<long long>(memoryWritten);
+    counters.hits.assign(levels.size(), 0);
+    counters.misses.assign(levels.size(), 0);
+    counters.writebacks.assign(levels.size(), 0);
+    counters.writeThroughs.assign(levels.size(), 0);
+    counters.trafficBytes.assign(levels.size(), 0);
+
+    vector<TagArena*> images;
+    vector<uint64_t> offsets;
+    uint64_t end = 0;
+    for (size_t level = 0; level < levels.size(); level++) {
+        CacheLevel& cache = levels[level];
+        uint64_t hits, misses, writebacks, writeThroughs, trafficBytes, random, fills;
+        if (!getWord(file, hits) || !getWord(file, misses) || !getWord(file, writebacks) ||
+            !getWord(file, writeThroughs) || !getWord(file, trafficBytes) || !getWord(file, random) ||
+            !getWord(file, fills)) {
+            error = "truncated or corrupt checkpoint";
+            return false;
+        }
+        counters.hits[level] = static_cast<long long>(hits);
+        counters.misses[level] = static_cast<long long>(misses);
+        counters.writebacks[level] = static_cast<long long>(writebacks);
+        counters.writeThroughs[level] = static_cast<long long>(writeThroughs);
+        counters.trafficBytes[level] = static_cast<long long>(trafficBytes);
+        cache.replacement.random = random;
+        cache.replacement.fills = static_cast<unsigned>(fills);
+        for (TagArena* arena : {&cache.store, &cache.replacement.arena}) {
+            uint64_t size, offset;
+            if (!getWord(file, size) || !getWord(file, offset) || size != arena->size() ||
+                offset % CHECKPOINT_ALIGN != 0) {
+                error = "truncated or corrupt checkpoint";
+                return false;
+            }
+            images.push_back(arena);
+            offsets.push_back(offset);
+            end = max(end, alignCheckpoint(offset + size));
+        }
+    }
+
+    // The closing magic is written last, so a checkpoint that has it is complete
+    end = max(end, alignCheckpoint(static_cast<uint64_t>(file.tellg())));
+    file.seekg(static_cast<streamoff>(end));
+    if (!file.read(magic, 4) || memcmp(magic, CHECKPOINT_MAGIC, 4) != 0) {
+        error = "truncated or corrupt checkpoint";
+        return false;
+    }
+    file.close();
+    for (size_t i = 0; i < images.size(); i++) {
+        if (!images[i]->load(filePath, offsets[i], error)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,45 @@
+#ifndef CACHE_SIMULATOR_CHECKPOINT_H
+#define CACHE_SIMULATOR_CHECKPOINT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "cacheLevel.h"
+
+// Counters of one hierarchy and how far into its trace they were taken
+struct CheckpointCounters {
+    uint64_t position = 0; // Trace accesses simulated
+    uint64_t accesses = 0; // Accesses counted, fewer than position when a run started from a warm checkpoint
+    std::vector<long long> hits, misses, writebacks, writeThroughs, trafficBytes; // Per level
+    long long memoryReadBytes = 0, memoryWriteBytes = 0;
+};
+
+// Checkpoint layout (integers 64-bit in host byte order unless noted):
+//   bytes 0-3   magic "CSCK"
+//   bytes 4-7   format version, 32-bit
+//   key length and key: the trace's hash and the settings of the hierarchy, which the state belongs to
+//   trace position, counted accesses, memory read bytes, memory written bytes
+//   the number of levels, and per level hits, misses, writebacks, write-throughs, traffic bytes, the
+//               replacement policy's generator and fill counter, and the size and file offset of the tag
+//               store and of the policy state
+//   the tag stores and policy states byte for byte, each starting on a CHECKPOINT_ALIGN boundary,
+//               with pages of zeros left as holes of the file
+//   the magic again, on a CHECKPOINT_ALIGN boundary, marking a complete checkpoint
+// The images need no parsing: a restore maps them into place copy-on-write, or reads them in one go. A
+// checkpoint is written next to its final name and renamed into place once complete.
+
+const char CHECKPOINT_MAGIC[4] = {'C', 'S', 'C', 'K'};
+const uint32_t CHECKPOINT_VERSION = 1;
+const uint64_t CHECKPOINT_ALIGN = 1 << 16; // A multiple of every common page size
+const size_t CHECKPOINT_PAGE = 4096; // Unit of the zero pages skipped when writing
+
+// Writes the contents of levels and the counters to filePath
+bool saveCheckpoint(const std::string& filePath, const std::string& key, const std::vector<CacheLevel>& levels,
+                    const CheckpointCounters& counters, std::string& error);
+
+// Restores what saveCheckpoint() wrote into levels of the same geometry; fails when the file holds
+// another key
+bool loadCheckpoint(const std::string& filePath, const std::string& key, std::vector<CacheLevel>& levels,
+                    CheckpointCounters& counters, std::string& error);
+
+#endif //CACHE_SIMULATOR_CHECKPOINT_H
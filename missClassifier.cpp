@@ -0,0 +1,108 @@
+#include "missClassifier.h"
+
+using namespace std;
+
+const uint64_t MissClassifier::HASH_MULTIPLIER;
+const int MissClassifier::PAGE_SHIFT;
+const size_t MissClassifier::PAGE_WORDS;
+
+MissClassifier::MissClassifier(int numLines) : nodes(numLines) {
+    int bits = 2;
+    while ((1LL << bits) < 4LL * numLines) {
+        bits++;
+    }
+    slots.assign(static_cast<size_t>(1) << bits, Slot{0, -1});
+    slotMask = slots.size() - 1;
+    slotShift = 64 - bits;
+}
+
+// Allocates a page of the first-touch bitmap, growing the page list to reach it
+void MissClassifier::addPage(size_t page) {
+    if (page >= pages.size()) {
+        pages.resize(page + 1 > 2 * pages.size() ? page + 1 : 2 * pages.size());
+    }
+    pages[page].assign(PAGE_WORDS, 0);
+}
+
+// Accesses line in the shadow cache and returns whether it hit
+bool MissClassifier::shadowAccess(int64_t line, bool allocate) {
+    uint64_t slot = home(line);
+    while (slots[slot].node >= 0) {
+        if (slots[slot].line == line) {
+            int node = slots[slot].node;
+            if (node != head) {
+                unlink(node);
+                pushFront(node);
+            }
+            return true;
+        }
+        slot = (slot + 1) & slotMask;
+    }
+    if (!allocate || nodes.empty()) {
+        return false;
+    }
+
+    int node;
+    if (used < static_cast<int>(nodes.size())) {
+        node = used++;
+    }
+    else {
+        // The least recently used line makes room; its slot may be the free one found above or shift
+        // into it, so the free slot is searched for again
+        node = tail;
+        unlink(node);
+        erase(node);
+        slot = home(line);
+        while (slots[slot].node >= 0) {
+            slot = (slot + 1) & slotMask;
+        }
+    }
+    nodes[node].line = line;
+    nodes[node].slot = static_cast<int>(slot);
+    slots[slot] = Slot{line, node};
+    pushFront(node);
+    return false;
+}
+
+// Empties node's slot, shifting back the entries after it that probed past it so no lookup stops early
+void MissClassifier::erase(int node) {
+    uint64_t hole = nodes[node].slot;
+    slots[hole].node = -1;
+    for (uint64_t slot = (hole + 1) & slotMask; slots[slot].node >= 0; slot = (slot + 1) & slotMask) {
+        // The entry may move into the hole unless its home lies cyclically in (hole, slot]
+        if (((slot - home(slots[slot].line)) & slotMask) >= ((slot - hole) & slotMask)) {
+            slots[hole] = slots[slot];
+            nodes[slots[hole].node].slot = static_cast<int>(hole);
+            slots[slot].node = -1;
+            hole = slot;
+        }
+    }
+}
+
+void MissClassifier::unlink(int node) {
+    Node& n = nodes[node];
+    if (n.prev >= 0) {
+        nodes[n.prev].next = n.next;
+    }
+    else {
+        head = n.next;
+    }
+    if (n.next >= 0) {
+        nodes[n.next].prev = n.prev;
+    }
+    else {
+        tail = n.prev;
+    }
+}
+
+void MissClassifier::pushFront(int node) {
+    nodes[node].prev = -1;
+    nodes[node].next = head;
+    if (head >= 0) {
+        nodes[head].prev = node;
+    }
+    head = node;
+    if (tail < 0) {
+        tail = node;
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef CACHE_SIMULATOR_MISSCLASSIFIER_H
+#define CACHE_SIMULATOR_MISSCLASSIFIER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Splits one level's misses into the three Cs (Hill):
+//   compulsory  the first access to the line anywhere in the trace, a miss at any size
+//   capacity    also a miss of a fully-associative LRU cache with as many lines as the level
+//   conflict    a hit of that cache, so only the level's set mapping or replacement lost the line
+//
+// It watches the demand accesses that reach the level, in the level's line numbers. First touches are
+// a bitmap over line numbers, allocated in pages as lines are first seen so a sparse trace of a wide
+// address space only pays for the regions it touches. The fully-associative shadow is a
+// hash table from line to node plus an LRU list threaded through the nodes, so every access is O(1).
+class MissClassifier {
+public:
+    MissClassifier() {}
+    explicit MissClassifier(int numLines);
+
+    uint64_t compulsory = 0;
+    uint64_t capacity = 0;
+    uint64_t conflict = 0;
+
+    // Access of line at the level, a hit or a miss. allocate is false for writes the level does not
+    // allocate on, which leave the shadow cache without the line as well.
+    void access(int64_t line, bool hit, bool allocate) {
+        // The bitmap word is read before the shadow lookup so a trip to memory for it overlaps the lookup
+        std::size_t page = static_cast<std::size_t>(line) >> PAGE_SHIFT;
+        if (page >= pages.size() || pages[page].empty()) {
+            addPage(page);
+        }
+        uint64_t& word = pages[page][(line >> 6) & (PAGE_WORDS - 1)];
+        uint64_t bit = 1ULL << (line & 63);
+        bool first = (word & bit) == 0;
+        bool shadowHit = shadowAccess(line, allocate);
+        word |= bit;
+        if (hit) {
+            return;
+        }
+        if (first) {
+            compulsory++;
+        }
+        else if (!shadowHit) {
+            capacity++;
+        }
+        else {
+            conflict++;
+        }
+    }
+
+private:
+    void addPage(std::size_t page);
+    bool shadowAccess(int64_t line, bool allocate);
+
+    uint64_t home(int64_t line) const { return static_cast<uint64_t>(line) * HASH_MULTIPLIER >> slotShift; }
+    void erase(int node);
+    void unlink(int node);
+    void pushFront(int node);
+
+    static const uint64_t HASH_MULTIPLIER = 0x9E3779B97F4A7C15ULL; // Fibonacci hashing, 2^64 / golden ratio
+
+    static const int PAGE_SHIFT = 16; // Lines per page of the bitmap, as a power of two
+    static const std::size_t PAGE_WORDS = (static_cast<std::size_t>(1) << PAGE_SHIFT) / 64;
+    std::vector<std::vector<uint64_t> > pages; // A bit per line accessed so far, empty pages never touched
+
+    // Shadow cache: nodes hold the lines, most recent first from head, and a table of slots finds a
+    // line's node by linear probing from its hash, with at least three quarters of the slots empty.
+    // Slots keep their line so probes stay in the table, and nodes their slot so evictions need no probe.
+    struct Node {
+        int64_t line;
+        int prev, next;
+        int slot;
+    };
+    struct Slot {
+        int64_t line;
+        int node; // -1 for an empty slot
+    };
+    std::vector<Node> nodes;
+    std::vector<Slot> slots;
+    uint64_t slotMask = 0;
+    int slotShift = 0;
+    int head = -1, tail = -1;
+    int used = 0; // Nodes holding a line
+};
+
+#endif //CACHE_SIMULATOR_MISSCLASSIFIER_H
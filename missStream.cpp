@@ -0,0 +1,218 @@
+#include "missStream.h"
+
+#include <cstdio>
+#include <cstring>
+#include "traceFormat.h"
+
+using namespace std;
+
+const size_t MissStreamWriter::BUFFER_SIZE;
+const size_t MissStreamReader::BUFFER_SIZE;
+
+// Folds one word into a running hash: multiply, then rotate so high bits reach the low ones
+inline uint64_t mixWord(uint64_t hash, uint64_t word) {
+    hash = (hash ^ word) * 0x9E3779B97F4A7C15ULL;
+    return (hash << 31) | (hash >> 33);
+}
+
+bool hashFile(const string& filePath, uint64_t& hash, string& error) {
+    ifstream file(filePath, ios::binary);
+    if (!file) {
+        error = "cannot open file";
+        return false;
+    }
+    vector<char> block(1 << 20);
+    hash = 0xCBF29CE484222325ULL;
+    uint64_t total = 0;
+    while (file) {
+        file.read(block.data(), block.size());
+        size_t got = static_cast<size_t>(file.gcount());
+        size_t i = 0;
+        for (; i + 8 <= got; i += 8) {
+            uint64_t word;
+            memcpy(&word, block.data() + i, 8);
+            hash = mixWord(hash, word);
+        }
+        uint64_t tail = 0;
+        memcpy(&tail, block.data() + i, got - i);
+        if (got > i) {
+            hash = mixWord(hash, tail);
+        }
+        total += got;
+    }
+    if (file.bad()) {
+        error = "read failed";
+        return false;
+    }
+    hash = mixWord(hash, total);
+    return true;
+}
+
+uint64_t hashString(const string& text) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (char c : text) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+bool MissStreamWriter::open(const string& filePath, const string& key, string& error) {
+    path = filePath;
+    file.open(path + ".tmp", ios::binary | ios::trunc);
+    if (!file) {
+        error = "cannot create file";
+        return false;
+    }
+    buffer.reserve(BUFFER_SIZE + 64);
+    buffer.insert(buffer.end(), MISS_STREAM_MAGIC, MISS_STREAM_MAGIC + 4);
+    buffer.push_back(MISS_STREAM_VERSION);
+    put(key.size());
+    buffer.insert(buffer.end(), key.begin(), key.end());
+    lastAddress = 0;
+    return true;
+}
+
+void MissStreamWriter::put(uint64_t value) {
+    uint8_t bytes[10];
+    buffer.insert(buffer.end(), bytes, bytes + writeVarint(value, bytes));
+}
+
+void MissStreamWriter::append(const PipelineMessage& message) {
+    uint64_t delta = zigzagEncode(static_cast<int64_t>(message.address - lastAddress));
+    lastAddress = message.address;
+    if (message.kind == PIPELINE_WRITE) {
+        put(delta << 2 | 2);
+        put(static_cast<uint64_t>(message.bytes));
+    }
+    else {
+        put(delta << 2 | (message.write ? 1 : 0));
+    }
+    if (buffer.size() >= BUFFER_SIZE) {
+        flush();
+    }
+}
+
+void MissStreamWriter::flush() {
+    file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    buffer.clear();
+}
+
+bool MissStreamWriter::close(uint64_t accesses, const vector<StageCounters>& levels, string& error) {
+    put(3);
+    put(accesses);
+    put(levels.size());
+    for (const StageCounters& level : levels) {
+        put(static_cast<uint64_t>(level.hits));
+        put(static_cast<uint64_t>(level.misses));
+        put(static_cast<uint64_t>(level.writebacks));
+        put(static_cast<uint64_t>(level.writeThroughs));
+        put(static_cast<uint64_t>(level.trafficBytes));
+    }
+    flush();
+    file.close();
+    if (file.fail()) {
+        error = "write failed";
+        remove((path + ".tmp").c_str());
+        return false;
+    }
+    remove(path.c_str());
+    if (rename((path + ".tmp").c_str(), path.c_str()) != 0) {
+        error = "cannot move the stream into place";
+        remove((path + ".tmp").c_str());
+        return false;
+    }
+    return true;
+}
+
+bool MissStreamReader::open(const string& filePath, const string& key) {
+    file.close();
+    file.clear();
+    file.open(filePath, ios::binary);
+    if (!file) {
+        return false;
+    }
+    buffer.resize(BUFFER_SIZE);
+    position = length = 0;
+    lastAddress = 0;
+    errorMessage.clear();
+
+    refill();
+    if (length < 5 || memcmp(buffer.data(), MISS_STREAM_MAGIC, 4) != 0 || buffer[4] != MISS_STREAM_VERSION) {
+        return false;
+    }
+    position = 5;
+    uint64_t keyLength;
+    if (!get(keyLength) || length - position < keyLength) {
+        errorMessage.clear();
+        return false;
+    }
+    string stored(buffer.begin() + position, buffer.begin() + position + keyLength);
+    position += keyLength;
+    return stored == key;
+}
+
+// Moves the unread bytes to the front of the buffer and reads more behind them
+void MissStreamReader::refill() {
+    memmove(buffer.data(), buffer.data() + position, length - position);
+    length -= position;
+    position = 0;
+    file.read(reinterpret_cast<char*>(buffer.data()) + length, buffer.size() - length);
+    length += static_cast<size_t>(file.gcount());
+}
+
+// Reads one varint, refilling the buffer first when fewer bytes than the longest varint are left
+bool MissStreamReader::get(uint64_t& value) {
+    if (length - position < 10 && file) {
+        refill();
+    }
+    const uint8_t* p = buffer.data() + position;
+    if (!readVarint(p, buffer.data() + length, value)) {
+        errorMessage = "truncated or corrupt miss stream";
+        return false;
+    }
+    position = p - buffer.data();
+    return true;
+}
+
+bool MissStreamReader::next(PipelineMessage& message) {
+    uint64_t value;
+    if (!get(value)) {
+        return false;
+    }
+    if ((value & 3) == 3) {
+        readCounters();
+        return false;
+    }
+    lastAddress += static_cast<uint64_t>(zigzagDecode(value >> 2));
+    message.address = lastAddress;
+    message.write = (value & 1) != 0;
+    message.kind = (value & 2) != 0 ? PIPELINE_WRITE : PIPELINE_ACCESS;
+    message.bytes = 0;
+    if (message.kind == PIPELINE_WRITE) {
+        uint64_t bytes;
+        if (!get(bytes)) {
+            return false;
+        }
+        message.bytes = static_cast<int>(bytes);
+    }
+    return true;
+}
+
+void MissStreamReader::readCounters() {
+    uint64_t count;
+    if (!get(accesses) || !get(count)) {
+        return;
+    }
+    levels.assign(count, StageCounters());
+    for (StageCounters& level : levels) {
+        uint64_t hits, misses, writebacks, writeThroughs, trafficBytes;
+        if (!get(hits) || !get(misses) || !get(writebacks) || !get(writeThroughs) || !get(trafficBytes)) {
+            return;
+        }
+        level.hits = static_cast<long long>(hits);
+        level.misses = static_cast<long long>(misses);
+        level.writebacks = static_cast<long long>(writebacks);
+        level.writeThroughs = static_cast<long long>(writeThroughs);
+        level.trafficBytes = static_cast<long long>(trafficBytes);
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef CACHE_SIMULATOR_MISSSTREAM_H
+#define CACHE_SIMULATOR_MISSSTREAM_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// What one level passes to the next: an access that missed every level above, written data on its way
+// down (a writeback, a write-through or a processor write), or the end of the trace. The pipelined
+// schedule sends these through its rings, and a stored miss stream holds those a level sent.
+enum PipelineKind : uint8_t {
+    PIPELINE_ACCESS,
+    PIPELINE_WRITE,
+    PIPELINE_END
+};
+
+struct PipelineMessage {
+    uint64_t address;
+    int bytes; // Written bytes of a PIPELINE_WRITE
+    PipelineKind kind;
+    bool write; // A PIPELINE_ACCESS is a processor write
+};
+
+// One stage's counters, on cache lines of their own so the stages never write to a shared line
+struct alignas(64) StageCounters {
+    long long hits = 0, misses = 0, writebacks = 0, writeThroughs = 0, trafficBytes = 0;
+    long long memoryReadBytes = 0, memoryWriteBytes = 0; // Last stage only
+};
+
+// Stored miss stream layout (all integers LEB128 varints unless noted):
+//   bytes 0-3   magic "CSMS"
+//   byte  4     format version
+//   key length and key: the trace's hash and the settings of every level down to the one that sent it
+//   one varint per message: the zigzag delta from the previous message's address, shifted left twice,
+//               with bit 1 set for PIPELINE_WRITE and then a varint of its bytes, bit 0 for a processor
+//               write; both bits set mark the end
+//   the trace's accesses, the number of levels, and per level hits, misses, writebacks, write-throughs
+//   and traffic bytes
+// A stream is written next to its final name and renamed into place once complete, so an interrupted run
+// never leaves a partial stream behind.
+
+const char MISS_STREAM_MAGIC[4] = {'C', 'S', 'M', 'S'};
+const uint8_t MISS_STREAM_VERSION = 1;
+
+// 64-bit hash of a file's contents, false when it cannot be read
+bool hashFile(const std::string& filePath, uint64_t& hash, std::string& error);
+
+// Hash of a string, for naming the file a key is stored in
+uint64_t hashString(const std::string& text);
+
+class MissStreamWriter {
+public:
+    static const size_t BUFFER_SIZE = 1 << 20;
+
+    bool open(const std::string& filePath, const std::string& key, std::string& error);
+    void append(const PipelineMessage& message);
+
+    // Ends the stream with the counters of the levels that produced it and moves it into place
+    bool close(uint64_t accesses, const std::vector<StageCounters>& levels, std::string& error);
+
+private:
+    void put(uint64_t value);
+    void flush();
+
+    std::ofstream file;
+    std::string path;
+    std::vector<uint8_t> buffer;
+    uint64_t lastAddress = 0;
+};
+
+class MissStreamReader {
+public:
+    static const size_t BUFFER_SIZE = 1 << 20;
+
+    // Opens the stream stored for key; false when there is none, or the file holds another key
+    bool open(const std::string& filePath, const std::string& key);
+
+    // The next message; false at the end of the stream, when accesses and levels hold its counters,
+    // or on error
+    bool next(PipelineMessage& message);
+
+    bool failed() const { return !errorMessage.empty(); }
+    const std::string& error() const { return errorMessage; }
+
+    uint64_t accesses = 0;
+    std::vector<StageCounters> levels;
+
+private:
+    void refill();
+    bool get(uint64_t& value);
+    void readCounters();
+
+    std::ifstream file;
+    std::vector<uint8_t> buffer;
+    size_t position = 0;
+    size_t length = 0;
+    uint64_t lastAddress = 0;
+    std::string errorMessage;
+};
+
+#endif //CACHE_SIMULATOR_MISSSTREAM_H
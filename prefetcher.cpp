@@ -0,0 +1,106 @@
+#include "prefetcher.h"
+
+using namespace std;
+
+Prefetcher::Prefetcher(PrefetcherKind kind, int degree, int numLines) : kind(kind), degree(degree) {
+    if (kind != PREFETCH_STREAM) {
+        pending.assign(numLines, 0);
+    }
+}
+
+void Prefetcher::train(int64_t line, bool hit, bool prefetchedHit, vector<int64_t>& candidates) {
+    switch (kind) {
+        case PREFETCH_NONE:
+            return;
+
+        case PREFETCH_NEXT_LINE:
+            // Tagged: the first use of a prefetched line keeps a sequential run going without misses
+            if (!hit || prefetchedHit) {
+                for (int i = 1; i <= degree; i++) {
+                    candidates.push_back(line + i);
+                }
+            }
+            return;
+
+        case PREFETCH_STRIDE: {
+            if (trained && line == lastLine) {
+                return; // Same line again says nothing about the stride
+            }
+            int64_t distance = line - lastLine;
+            bool confirmed = trained && distance == stride;
+            stride = distance;
+            lastLine = line;
+            if (!trained) {
+                trained = true;
+                return;
+            }
+            if (confirmed) {
+                for (int i = 1; i <= degree; i++) {
+                    candidates.push_back(line + stride * i);
+                }
+            }
+            return;
+        }
+
+        case PREFETCH_STREAM:
+            // A miss restarts the buffer behind it; taking the head tops it up by one line
+            if (!hit) {
+                stream.clear();
+                nextStreamLine = line + 1;
+                for (int i = 0; i < degree; i++) {
+                    candidates.push_back(nextStreamLine++);
+                }
+            }
+            else if (prefetchedHit) {
+                candidates.push_back(nextStreamLine++);
+            }
+            return;
+    }
+}
+
+void Prefetcher::push(int64_t line, uint64_t readyAt) {
+    if (static_cast<int>(stream.size()) < degree) {
+        stream.push_back(make_pair(line, readyAt));
+    }
+}
+
+bool Prefetcher::buffered(int64_t line) const {
+    for (const pair<int64_t, uint64_t>& entry : stream) {
+        if (entry.first == line) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Prefetcher::takeHead(int64_t line, uint64_t now, uint64_t& stall) {
+    if (stream.empty() || stream.front().first != line) {
+        return false;
+    }
+    consume(stream.front().second, now, stall);
+    stream.pop_front();
+    return true;
+}
+
+string Prefetcher::describe() const {
+    if (kind == PREFETCH_NONE) {
+        return prefetcherName(kind);
+    }
+    return string(prefetcherName(kind)) + ":" + to_string(degree);
+}
+
+bool Prefetcher::consume(uint64_t& readyAt, uint64_t now, uint64_t& stall) {
+    if (readyAt == 0) {
+        return false;
+    }
+    if (now < readyAt) {
+        late++;
+        lateCycles += readyAt - now;
+        stall += readyAt - now;
+    }
+    else {
+        useful++;
+    }
+    readyAt = 0;
+    return true;
+}
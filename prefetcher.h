@@ -0,0 +1,104 @@
+#ifndef CACHE_SIMULATOR_PREFETCHER_H
+#define CACHE_SIMULATOR_PREFETCHER_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Hardware prefetchers that can be attached to a cache level. Each watches the demand accesses that
+// reach its level, in line numbers of that level, and names the lines to fetch ahead of them:
+//   next-line  after a miss, or the first use of a prefetched line, the next degree lines
+//   stride     once the same distance separates three accesses in a row, the next degree lines at that
+//              distance (no program counter, so one stride per level)
+//   stream     a stream buffer of degree lines following a miss, held beside the cache; a miss that
+//              finds its line at the head of the buffer takes it from there and the buffer fetches one more
+enum PrefetcherKind {
+    PREFETCH_NONE,
+    PREFETCH_NEXT_LINE,
+    PREFETCH_STRIDE,
+    PREFETCH_STREAM
+};
+
+inline const char* prefetcherName(PrefetcherKind kind) {
+    switch (kind) {
+        case PREFETCH_NONE: return "none";
+        case PREFETCH_NEXT_LINE: return "next-line";
+        case PREFETCH_STRIDE: return "stride";
+        case PREFETCH_STREAM: return "stream";
+    }
+    return "?";
+}
+
+// Accepts the names printed by prefetcherName()
+inline bool parsePrefetcher(const std::string& name, PrefetcherKind& kind) {
+    for (int i = PREFETCH_NONE; i <= PREFETCH_STREAM; i++) {
+        if (name == prefetcherName(static_cast<PrefetcherKind>(i))) {
+            kind = static_cast<PrefetcherKind>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const int MAX_PREFETCH_DEGREE = 64;
+
+// One level's prefetcher and its counters. Times are in cycles of the hierarchy's clock: a prefetched
+// line is ready once the level it came from has answered, and a demand access that uses it earlier
+// is late and waits for the rest.
+class Prefetcher {
+public:
+    Prefetcher() {}
+    Prefetcher(PrefetcherKind kind, int degree, int numLines);
+
+    PrefetcherKind kind = PREFETCH_NONE;
+    int degree = 0; // Lines fetched per trigger, the buffer depth for a stream buffer
+
+    uint64_t issued = 0; // Prefetches sent to the levels below
+    uint64_t useful = 0; // Used by a demand access after they arrived
+    uint64_t late = 0; // Used by a demand access before they arrived
+    uint64_t lateCycles = 0; // Cycles demand accesses waited for late prefetches
+
+    // Never used: evicted, dropped from the stream buffer, or still waiting when the trace ends
+    uint64_t useless() const { return issued - useful - late; }
+
+    // Demand access of line at this level, a hit or a miss, and whether the hit used a prefetched line.
+    // Appends the lines to prefetch to candidates.
+    void train(int64_t line, bool hit, bool prefetchedHit, std::vector<int64_t>& candidates);
+
+    // Prefetches placed in the cache, per line of the level (set * ways + way): placed() marks a prefetched
+    // line and when it is ready, filled() a line brought in by demand. A stream buffer keeps none.
+    void placed(int slot, uint64_t readyAt) { pending[slot] = readyAt; }
+    void filled(int slot) {
+        if (!pending.empty()) {
+            pending[slot] = 0;
+        }
+    }
+
+    // Demand hit on slot at time now: if it holds an unused prefetched line, counts it useful or late,
+    // adds any wait to stall and returns true
+    bool use(int slot, uint64_t now, uint64_t& stall) {
+        return !pending.empty() && consume(pending[slot], now, stall);
+    }
+
+    // Stream buffer: push() adds a fetched line, buffered() checks for one, and takeHead() pops the head
+    // when it is line, counting it like use()
+    void push(int64_t line, uint64_t readyAt);
+    bool buffered(int64_t line) const;
+    bool takeHead(int64_t line, uint64_t now, uint64_t& stall);
+
+    // "next-line:2", or "none"
+    std::string describe() const;
+
+private:
+    bool consume(uint64_t& readyAt, uint64_t now, uint64_t& stall);
+
+    std::vector<uint64_t> pending; // Per line, ready time of an unused prefetched line, 0 otherwise
+    std::deque<std::pair<int64_t, uint64_t> > stream; // Stream buffer lines and their ready times
+    int64_t nextStreamLine = 0;
+    int64_t lastLine = 0, stride = 0; // Stride detection
+    bool trained = false;
+};
+
+#endif //CACHE_SIMULATOR_PREFETCHER_H
@@ -0,0 +1,365 @@
+#ifndef CACHE_SIMULATOR_REPLACEMENTPOLICY_H
+#define CACHE_SIMULATOR_REPLACEMENTPOLICY_H
+
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include "tagArena.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Replacement policies of a set-associative level
+enum ReplacementPolicy {
+    POLICY_LRU, // True LRU, an MRU stack of way numbers
+    POLICY_PLRU, // Tree pseudo-LRU, ways - 1 bits per set (power-of-two ways only)
+    POLICY_SRRIP, // Static re-reference interval prediction, 2-bit RRPV per way
+    POLICY_BRRIP, // Bimodal RRIP: SRRIP that inserts at distant re-reference most of the time
+    POLICY_FIFO, // Round-robin pointer per set
+    POLICY_RANDOM // Per-level xorshift generator, no per-set state
+};
+
+inline const char* policyName(ReplacementPolicy policy) {
+    switch (policy) {
+        case POLICY_LRU: return "LRU";
+        case POLICY_PLRU: return "PLRU";
+        case POLICY_SRRIP: return "SRRIP";
+        case POLICY_BRRIP: return "BRRIP";
+        case POLICY_FIFO: return "FIFO";
+        case POLICY_RANDOM: return "RANDOM";
+    }
+    return "?";
+}
+
+// Accepts the names printed by policyName(), case-insensitively
+inline bool parsePolicy(std::string name, ReplacementPolicy& policy) {
+    for (char& c : name) {
+        c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+    }
+    for (int i = POLICY_LRU; i <= POLICY_RANDOM; i++) {
+        if (name == policyName(static_cast<ReplacementPolicy>(i))) {
+            policy = static_cast<ReplacementPolicy>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const int RRPV_MAX = 3; // Distant re-reference for 2-bit RRIP
+const unsigned BRRIP_LONG_INTERVAL = 32; // BRRIP inserts at RRPV_MAX - 1 once every this many fills
+const int MAX_POLICY_WORDS = 8; // Largest per-set state: 64 ways of 8-bit LRU fields
+
+inline int lowestBit(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+// Replacement state of every set of one level, bit-packed into 64-bit words. Each set owns
+// bitsPerSet bits, rounded up to a power of two (or a whole number of words) so that no set and
+// no per-way field ever straddles a word boundary. The words start zeroed, which is a valid state
+// of every set under every policy, so they live in a TagArena that the OS backs only where used.
+struct PolicyState {
+    ReplacementPolicy policy = POLICY_LRU;
+    int ways = 1;
+    int fieldBits = 0; // Width of one per-way field (LRU stack entry, RRPV) or of the FIFO pointer
+    int bitsPerSet = 0;
+    int wordsPerSet = 1; // Words a set spans, 1 when sets share words
+    int fieldsPerWord = 0; // Fields of one set that sit in one word
+    uint64_t fieldOnes[MAX_POLICY_WORDS] = {}; // Lowest bit of every per-way field, per word of a set
+    uint64_t fieldIndex[MAX_POLICY_WORDS] = {}; // Field i holding i, per word of a set
+    TagArena arena;
+    uint64_t random = 0x9E3779B97F4A7C15ULL; // RANDOM victim generator, advanced on every fill
+    unsigned fills = 0; // BRRIP insertion counter
+
+    void init(ReplacementPolicy replacement, int numSets, int numWays);
+
+    const uint64_t* words() const { return reinterpret_cast<const uint64_t*>(arena.data()); }
+    uint64_t* writableWords() { return reinterpret_cast<uint64_t*>(arena.writable()); }
+
+    unsigned field(int set, int i) const {
+        size_t pos = static_cast<size_t>(set) * bitsPerSet + static_cast<size_t>(i) * fieldBits;
+        return static_cast<unsigned>(words()[pos >> 6] >> (pos & 63)) & ((1u << fieldBits) - 1);
+    }
+
+    void setField(int set, int i, unsigned value) {
+        size_t pos = static_cast<size_t>(set) * bitsPerSet + static_cast<size_t>(i) * fieldBits;
+        uint64_t mask = ((1ULL << fieldBits) - 1) << (pos & 63);
+        uint64_t& word = writableWords()[pos >> 6];
+        word = (word & ~mask) | (static_cast<uint64_t>(value) << (pos & 63));
+    }
+
+    // Copies the state of one set to/from wordsPerSet local words, so whole-set updates run on
+    // registers with SIMD-within-a-register arithmetic instead of field by field
+    void load(int set, uint64_t* bits) const {
+        if (bitsPerSet >= 64) {
+            const uint64_t* first = words() + static_cast<size_t>(set) * wordsPerSet;
+            for (int j = 0; j < wordsPerSet; j++) {
+                bits[j] = first[j];
+            }
+            return;
+        }
+        size_t pos = static_cast<size_t>(set) * bitsPerSet;
+        bits[0] = (words()[pos >> 6] >> (pos & 63)) & ((1ULL << bitsPerSet) - 1);
+    }
+
+    void store(int set, const uint64_t* bits) {
+        if (bitsPerSet >= 64) {
+            uint64_t* first = writableWords() + static_cast<size_t>(set) * wordsPerSet;
+            for (int j = 0; j < wordsPerSet; j++) {
+                first[j] = bits[j];
+            }
+            return;
+        }
+        size_t pos = static_cast<size_t>(set) * bitsPerSet;
+        uint64_t mask = ((1ULL << bitsPerSet) - 1) << (pos & 63);
+        uint64_t& word = writableWords()[pos >> 6];
+        word = (word & ~mask) | (bits[0] << (pos & 63));
+    }
+
+    // Position of the first per-way field equal to value, or -1. Uses the classic zero-field test:
+    // after xoring value into every field, only a field that became zero borrows into its top bit.
+    int firstEqual(const uint64_t* bits, unsigned value) const {
+        for (int j = 0; j < wordsPerSet; j++) {
+            uint64_t ones = fieldOnes[j];
+            uint64_t x = bits[j] ^ (ones * value);
+            uint64_t zero = (x - ones) & ~x & (ones << (fieldBits - 1));
+            if (zero != 0) {
+                return j * fieldsPerWord + lowestBit(zero) / fieldBits;
+            }
+        }
+        return -1;
+    }
+
+    // Per-access hooks, dispatched on the policy with a switch (no virtual call per access)
+    inline void touch(int set, int way); // Hit on way
+    inline int victim(int set) const; // Way to replace when the set is full, does not change any state
+    inline void insert(int set, int way, bool replaced); // A new line was filled into way, replaced if it held one
+};
+
+// Smallest power-of-two width (1, 2, 4 or 8 bits) that holds values up to maxValue
+inline int packedWidth(unsigned maxValue) {
+    int width = 1;
+    while ((1u << width) <= maxValue) {
+        width *= 2;
+    }
+    return width;
+}
+
+// MRU stack of way numbers: field 0 holds the most recently used way, field ways - 1 the LRU way.
+// A hit finds the way's stack position with one zero-field test per word and shifts the fields in
+// front of it up by one, so an update costs a handful of word operations even at 16-64 ways.
+// Fields are stored xored with their position, so a zeroed set is the stack 0, 1, ..., ways - 1.
+struct LruPolicy {
+    static int fieldBits(int ways) {
+        return packedWidth(ways - 1) < 2 ? 2 : packedWidth(ways - 1); // The zero-field test needs 2 bits
+    }
+    static int bitsPerSet(int ways) { return ways * fieldBits(ways); }
+
+    static void touch(PolicyState& state, int set, int way) {
+        uint64_t bits[MAX_POLICY_WORDS];
+        state.load(set, bits);
+        for (int j = 0; j < state.wordsPerSet; j++) {
+            bits[j] ^= state.fieldIndex[j];
+        }
+        int position = state.firstEqual(bits, way);
+        int width = state.fieldBits;
+        int word = position / state.fieldsPerWord;
+        int shift = (position % state.fieldsPerWord) * width;
+
+        // Whole words in front of the way's word move up one field, carrying their top field along
+        uint64_t carry = static_cast<uint64_t>(way);
+        for (int j = 0; j < word; j++) {
+            uint64_t top = bits[j] >> (64 - width);
+            bits[j] = (bits[j] << width) | carry;
+            carry = top;
+        }
+        uint64_t below = shift == 0 ? 0 : bits[word] & (~0ULL >> (64 - shift));
+        uint64_t above = shift + width >= 64 ? 0 : bits[word] & (~0ULL << (shift + width));
+        bits[word] = above | (below << width) | carry;
+        for (int j = 0; j < state.wordsPerSet; j++) {
+            bits[j] ^= state.fieldIndex[j];
+        }
+        state.store(set, bits);
+    }
+
+    static int victim(const PolicyState& state, int set) {
+        return static_cast<int>(state.field(set, state.ways - 1) ^ static_cast<unsigned>(state.ways - 1));
+    }
+
+    static void insert(PolicyState& state, int set, int way) { touch(state, set, way); }
+};
+
+// Binary tree of ways - 1 one-bit nodes in heap order (node n at bit n - 1); a node's bit points
+// at the half that holds the next victim, accesses flip the nodes on their path away from themselves
+struct PlruPolicy {
+    static int fieldBits(int) { return 1; }
+    static int bitsPerSet(int ways) { return ways - 1; }
+
+    static void touch(PolicyState& state, int set, int way) {
+        int node = 1;
+        for (int bit = state.ways >> 1; bit > 0; bit >>= 1) {
+            int right = (way & bit) ? 1 : 0;
+            state.setField(set, node - 1, right ? 0 : 1);
+            node = 2 * node + right;
+        }
+    }
+
+    static int victim(const PolicyState& state, int set) {
+        int node = 1;
+        while (node < state.ways) {
+            node = 2 * node + static_cast<int>(state.field(set, node - 1));
+        }
+        return node - state.ways;
+    }
+
+    static void insert(PolicyState& state, int set, int way) { touch(state, set, way); }
+};
+
+// 2-bit re-reference prediction values; hits predict near re-reference, the victim is the first way
+// predicted distant, ageing the whole set first when no way is. Searches and ageing work on whole
+// words (up to 32 ways per word). Victims are only chosen in full sets, whose every way was given its
+// value on insertion, so sets need no initial values, and fills of invalid ways age nothing.
+struct RripPolicy {
+    static int fieldBits(int) { return 2; }
+    static int bitsPerSet(int ways) { return 2 * ways; }
+
+    static void touch(PolicyState& state, int set, int way) { state.setField(set, way, 0); }
+
+    // First way holding the largest RRPV, which is stored in oldest
+    static int oldestWay(const PolicyState& state, const uint64_t* bits, unsigned& oldest) {
+        for (oldest = RRPV_MAX; oldest > 0; oldest--) {
+            int way = state.firstEqual(bits, oldest);
+            if (way >= 0) {
+                return way;
+            }
+        }
+        return 0;
+    }
+
+    static int victim(const PolicyState& state, int set) {
+        uint64_t bits[MAX_POLICY_WORDS];
+        state.load(set, bits);
+        unsigned oldest;
+        return oldestWay(state, bits, oldest);
+    }
+
+    // When way replaced a line, ages the set until the oldest way is distant (what the victim search
+    // would have done); then inserts with the given prediction
+    static void insert(PolicyState& state, int set, int way, unsigned rrpv, bool replaced) {
+        uint64_t bits[MAX_POLICY_WORDS];
+        state.load(set, bits);
+        unsigned oldest = RRPV_MAX;
+        if (replaced) {
+            oldestWay(state, bits, oldest);
+        }
+        if (oldest < RRPV_MAX) {
+            for (int j = 0; j < state.wordsPerSet; j++) {
+                bits[j] += state.fieldOnes[j] * (RRPV_MAX - oldest); // No field can carry past RRPV_MAX
+            }
+            state.store(set, bits);
+        }
+        state.setField(set, way, rrpv);
+    }
+};
+
+// One pointer per set to the oldest filled way
+struct FifoPolicy {
+    static int fieldBits(int ways) { return packedWidth(ways - 1); }
+    static int bitsPerSet(int ways) { return fieldBits(ways); }
+
+    static void touch(PolicyState&, int, int) {}
+    static int victim(const PolicyState& state, int set) { return static_cast<int>(state.field(set, 0)); }
+
+    static void insert(PolicyState& state, int set, int way) {
+        state.setField(set, 0, static_cast<unsigned>((way + 1) % state.ways));
+    }
+};
+
+inline void PolicyState::init(ReplacementPolicy replacement, int numSets, int numWays) {
+    policy = replacement;
+    ways = numWays;
+    switch (policy) {
+        case POLICY_LRU: fieldBits = LruPolicy::fieldBits(ways); bitsPerSet = LruPolicy::bitsPerSet(ways); break;
+        case POLICY_PLRU: fieldBits = PlruPolicy::fieldBits(ways); bitsPerSet = PlruPolicy::bitsPerSet(ways); break;
+        case POLICY_SRRIP:
+        case POLICY_BRRIP: fieldBits = RripPolicy::fieldBits(ways); bitsPerSet = RripPolicy::bitsPerSet(ways); break;
+        case POLICY_FIFO: fieldBits = FifoPolicy::fieldBits(ways); bitsPerSet = FifoPolicy::bitsPerSet(ways); break;
+        case POLICY_RANDOM: fieldBits = 0; bitsPerSet = 0; break;
+    }
+    if (ways == 1) {
+        bitsPerSet = 0; // Direct-mapped, nothing to choose between
+    }
+    // Round up so sets never straddle words: a power of two below 64 bits, whole words above
+    if (bitsPerSet > 64) {
+        bitsPerSet = (bitsPerSet + 63) / 64 * 64;
+    }
+    else if (bitsPerSet > 0) {
+        int rounded = 1;
+        while (rounded < bitsPerSet) {
+            rounded *= 2;
+        }
+        bitsPerSet = rounded;
+    }
+    arena = TagArena((static_cast<size_t>(numSets) * bitsPerSet + 63) / 64 * sizeof(uint64_t));
+    wordsPerSet = bitsPerSet > 64 ? bitsPerSet / 64 : 1;
+    for (int j = 0; j < MAX_POLICY_WORDS; j++) {
+        fieldOnes[j] = 0;
+        fieldIndex[j] = 0;
+    }
+    if (bitsPerSet == 0) {
+        return;
+    }
+    fieldsPerWord = (bitsPerSet >= 64 ? 64 : bitsPerSet) / fieldBits;
+    for (int i = 0; i < ways && i / fieldsPerWord < MAX_POLICY_WORDS; i++) {
+        fieldOnes[i / fieldsPerWord] |= 1ULL << ((i % fieldsPerWord) * fieldBits);
+        fieldIndex[i / fieldsPerWord] |= static_cast<uint64_t>(i) << ((i % fieldsPerWord) * fieldBits);
+    }
+}
+
+inline void PolicyState::touch(int set, int way) {
+    switch (policy) {
+        case POLICY_LRU: LruPolicy::touch(*this, set, way); break;
+        case POLICY_PLRU: PlruPolicy::touch(*this, set, way); break;
+        case POLICY_SRRIP:
+        case POLICY_BRRIP: RripPolicy::touch(*this, set, way); break;
+        case POLICY_FIFO:
+        case POLICY_RANDOM: break;
+    }
+}
+
+inline int PolicyState::victim(int set) const {
+    switch (policy) {
+        case POLICY_LRU: return LruPolicy::victim(*this, set);
+        case POLICY_PLRU: return PlruPolicy::victim(*this, set);
+        case POLICY_SRRIP:
+        case POLICY_BRRIP: return RripPolicy::victim(*this, set);
+        case POLICY_FIFO: return FifoPolicy::victim(*this, set);
+        case POLICY_RANDOM: return static_cast<int>((random >> 33) % static_cast<unsigned>(ways));
+    }
+    return 0;
+}
+
+inline void PolicyState::insert(int set, int way, bool replaced) {
+    switch (policy) {
+        case POLICY_LRU: LruPolicy::insert(*this, set, way); break;
+        case POLICY_PLRU: PlruPolicy::insert(*this, set, way); break;
+        case POLICY_SRRIP: RripPolicy::insert(*this, set, way, RRPV_MAX - 1, replaced); break;
+        case POLICY_BRRIP:
+            RripPolicy::insert(*this, set, way, ++fills % BRRIP_LONG_INTERVAL == 0 ? RRPV_MAX - 1 : RRPV_MAX,
+                               replaced);
+            break;
+        case POLICY_FIFO: FifoPolicy::insert(*this, set, way); break;
+        case POLICY_RANDOM:
+            random ^= random << 13;
+            random ^= random >> 7;
+            random ^= random << 17;
+            break;
+    }
+}
+
+#endif //CACHE_SIMULATOR_REPLACEMENTPOLICY_H
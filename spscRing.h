@@ -0,0 +1,97 @@
+#ifndef CACHE_SIMULATOR_SPSCRING_H
+#define CACHE_SIMULATOR_SPSCRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Bounded lock-free queue between exactly one producer thread and one consumer thread. Each side keeps
+// its own position and a cached copy of the other's, and only publishes its position every
+// PUBLISH_BATCH items (or when it would otherwise wait), so the shared indices change cache-line
+// ownership once per batch rather than once per item. A side that has to wait yields, so pipelines
+// with more stages than cores still make progress.
+template <typename T>
+class SpscRing {
+public:
+    static const size_t PUBLISH_BATCH = 256;
+
+    // Room for capacity items, rounded up to a power of two
+    explicit SpscRing(size_t capacity) {
+        size_t size = PUBLISH_BATCH * 2;
+        while (size < capacity) {
+            size *= 2;
+        }
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    // Producer side
+    void push(const T& item) {
+        if (producer.position - producer.otherCached == slots.size()) {
+            publish();
+            while (producer.position - (producer.otherCached = head.load(std::memory_order_acquire)) == slots.size()) {
+                std::this_thread::yield();
+            }
+        }
+        slots[producer.position & mask] = item;
+        producer.position++;
+        if (producer.position - producer.published >= PUBLISH_BATCH) {
+            publish();
+        }
+    }
+
+    // Makes every pushed item visible to the consumer
+    void publish() {
+        producer.published = producer.position;
+        tail.store(producer.position, std::memory_order_release);
+    }
+
+    // Consumer side: whether an item is waiting
+    bool ready() {
+        if (consumer.position != consumer.otherCached) {
+            return true;
+        }
+        consumer.otherCached = tail.load(std::memory_order_acquire);
+        return consumer.position != consumer.otherCached;
+    }
+
+    // Consumer side: waits for the next item
+    T pop() {
+        if (consumer.position == consumer.otherCached) {
+            release();
+            while (consumer.position == (consumer.otherCached = tail.load(std::memory_order_acquire))) {
+                std::this_thread::yield();
+            }
+        }
+        T item = slots[consumer.position & mask];
+        consumer.position++;
+        if (consumer.position - consumer.published >= PUBLISH_BATCH) {
+            release();
+        }
+        return item;
+    }
+
+private:
+    // Hands the consumed slots back to the producer
+    void release() {
+        consumer.published = consumer.position;
+        head.store(consumer.position, std::memory_order_release);
+    }
+
+    // One side's private state, on a cache line of its own
+    struct alignas(64) Side {
+        size_t position = 0; // Items pushed (producer) or popped (consumer) so far
+        size_t published = 0; // Position last stored in the shared index
+        size_t otherCached = 0; // Last value read from the other side's shared index
+    };
+
+    std::vector<T> slots;
+    size_t mask = 0;
+    alignas(64) std::atomic<size_t> head{0}; // Items the consumer has released
+    alignas(64) std::atomic<size_t> tail{0}; // Items the producer has published
+    Side producer;
+    Side consumer;
+};
+
+#endif //CACHE_SIMULATOR_SPSCRING_H
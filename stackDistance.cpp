@@ -0,0 +1,87 @@
+#include "stackDistance.h"
+
+using namespace std;
+
+const uint32_t MIN_TIMELINE_SLOTS = 64;
+
+StackDistanceAnalyzer::StackDistanceAnalyzer(int lineSize, int numSets)
+    : bytesPerLine(lineSize), timelines(numSets > 0 ? numSets : 1) {
+}
+
+void StackDistanceAnalyzer::access(uint64_t address) {
+    int64_t line = static_cast<int64_t>(address / static_cast<unsigned>(bytesPerLine));
+    Timeline& timeline = timelines[line % timelines.size()];
+    if (timeline.next == timeline.lineAt.size()) {
+        compact(timeline);
+    }
+    totalAccesses++;
+
+    uint32_t slot = timeline.next++;
+    auto found = position.find(line);
+    if (found == position.end()) {
+        firstTouches++;
+        position.emplace(line, slot);
+    }
+    else {
+        // Marked slots after the previous access are the distinct lines touched since
+        uint32_t previous = found->second;
+        uint32_t upToPrevious = 0;
+        for (int64_t i = previous; i >= 0; i = (i & (i + 1)) - 1) {
+            upToPrevious += timeline.tree[i];
+        }
+        uint32_t distance = timeline.live - upToPrevious;
+        if (distance >= counts.size()) {
+            counts.resize(distance + 1, 0);
+        }
+        counts[distance]++;
+
+        for (size_t i = previous; i < timeline.tree.size(); i |= i + 1) {
+            timeline.tree[i]--;
+        }
+        timeline.lineAt[previous] = -1;
+        timeline.live--;
+        found->second = slot;
+    }
+
+    for (size_t i = slot; i < timeline.tree.size(); i |= i + 1) {
+        timeline.tree[i]++;
+    }
+    timeline.lineAt[slot] = line;
+    timeline.live++;
+}
+
+// Renumbers the live slots 0..live-1 in access order, in a timeline with room for as many again
+void StackDistanceAnalyzer::compact(Timeline& timeline) {
+    uint32_t slots = 2 * timeline.live > MIN_TIMELINE_SLOTS ? 2 * timeline.live : MIN_TIMELINE_SLOTS;
+    vector<int64_t> lineAt(slots, -1);
+    uint32_t live = 0;
+    for (uint32_t i = 0; i < timeline.next; i++) {
+        if (timeline.lineAt[i] >= 0) {
+            lineAt[live] = timeline.lineAt[i];
+            position[lineAt[live]] = live;
+            live++;
+        }
+    }
+
+    // Linear-time Fenwick construction from the all-ones prefix
+    vector<uint32_t> tree(slots, 0);
+    for (uint32_t i = 0; i < slots; i++) {
+        tree[i] += i < live ? 1 : 0;
+        uint32_t parent = i | (i + 1);
+        if (parent < slots) {
+            tree[parent] += tree[i];
+        }
+    }
+
+    timeline.tree.swap(tree);
+    timeline.lineAt.swap(lineAt);
+    timeline.next = live;
+}
+
+uint64_t StackDistanceAnalyzer::hits(uint64_t linesPerSet) const {
+    uint64_t total = 0;
+    for (size_t distance = 0; distance < counts.size() && distance < linesPerSet; distance++) {
+        total += counts[distance];
+    }
+    return total;
+}
@@ -0,0 +1,53 @@
+#ifndef CACHE_SIMULATOR_STACKDISTANCE_H
+#define CACHE_SIMULATOR_STACKDISTANCE_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Mattson stack-distance analysis: one pass over a trace gives the LRU hit count of every capacity.
+// An access's stack distance is the number of distinct lines of its set touched since its previous
+// access, so it hits in an LRU cache of ways lines per set exactly when that distance is below ways.
+// With one set this is every fully-associative capacity; with the set count of a real level it is
+// every associativity of that level.
+//
+// Each set keeps a timeline of access slots with a Fenwick tree marking the slots that still hold
+// the latest access of some line, so a distance is one prefix sum (O(log n) per access). Timelines
+// are compacted when full, keeping memory proportional to the distinct lines rather than the trace.
+class StackDistanceAnalyzer {
+public:
+    StackDistanceAnalyzer(int lineSize, int numSets = 1);
+
+    void access(uint64_t address);
+
+    uint64_t accesses() const { return totalAccesses; }
+    uint64_t coldMisses() const { return firstTouches; } // First touch of a line, a miss at any size
+    uint64_t distinctLines() const { return position.size(); }
+    int lineSize() const { return bytesPerLine; }
+    int numSets() const { return timelines.size(); }
+
+    // Hits of an LRU cache with this many lines per set (for one set: this many lines in total)
+    uint64_t hits(uint64_t linesPerSet) const;
+
+    // Accesses per stack distance; distance counts.size() and beyond never occurred
+    const std::vector<uint64_t>& histogram() const { return counts; }
+
+private:
+    struct Timeline {
+        std::vector<uint32_t> tree; // Fenwick tree over slots, 1 where a slot is some line's latest access
+        std::vector<int64_t> lineAt; // Line accessed in each slot, -1 once superseded
+        uint32_t next = 0; // Next free slot
+        uint32_t live = 0; // Marked slots, the distinct lines of the set so far
+    };
+
+    void compact(Timeline& timeline);
+
+    int bytesPerLine;
+    std::vector<Timeline> timelines;
+    std::unordered_map<int64_t, uint32_t> position; // Line -> slot of its latest access in its set's timeline
+    std::vector<uint64_t> counts;
+    uint64_t totalAccesses = 0;
+    uint64_t firstTouches = 0;
+};
+
+#endif //CACHE_SIMULATOR_STACKDISTANCE_H
@@ -0,0 +1,190 @@
+#include "tagArena.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+const size_t TagArena::HUGE_PAGE_SIZE;
+
+// Bytes a mapped arena of size occupies: whole huge pages
+static size_t hugePageRound(size_t size) {
+    return (size + TagArena::HUGE_PAGE_SIZE - 1) / TagArena::HUGE_PAGE_SIZE * TagArena::HUGE_PAGE_SIZE;
+}
+
+TagArena::TagArena(size_t bytes) {
+    allocate(bytes);
+}
+
+TagArena::TagArena(const TagArena& other) {
+    allocate(other.length);
+    if (other.written && length > 0) {
+        memcpy(bytes, other.bytes, length);
+        written = true;
+    }
+}
+
+TagArena::TagArena(TagArena&& other) noexcept
+    : bytes(other.bytes), length(other.length), mapped(other.mapped), written(other.written) {
+    other.bytes = nullptr;
+    other.length = 0;
+    other.mapped = false;
+    other.written = false;
+}
+
+TagArena& TagArena::operator=(TagArena other) noexcept {
+    swap(bytes, other.bytes);
+    swap(length, other.length);
+    swap(mapped, other.mapped);
+    swap(written, other.written);
+    return *this;
+}
+
+TagArena::~TagArena() {
+    release();
+}
+
+bool TagArena::read(const string& filePath, uint64_t offset, string& error) {
+    ifstream file(filePath, ios::binary);
+    file.seekg(static_cast<streamoff>(offset));
+    file.read(bytes, static_cast<streamsize>(length));
+    if (!file || static_cast<size_t>(file.gcount()) != length) {
+        error = "file ends early";
+        return false;
+    }
+    written = true;
+    return true;
+}
+
+#ifdef _WIN32
+
+void TagArena::allocate(size_t size) {
+    length = size;
+    if (size == 0) {
+        return;
+    }
+    // Large pages need a privilege most accounts lack, so Windows gets plain committed pages, which
+    // also start zeroed and are only backed once touched
+    if (size >= HUGE_PAGE_SIZE) {
+        bytes = static_cast<char*>(VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+        if (bytes != nullptr) {
+            mapped = true;
+            return;
+        }
+    }
+    bytes = static_cast<char*>(calloc(size, 1));
+    if (bytes == nullptr) {
+        throw bad_alloc();
+    }
+}
+
+void TagArena::release() {
+    if (bytes != nullptr) {
+        if (mapped) {
+            VirtualFree(bytes, 0, MEM_RELEASE);
+        }
+        else {
+            free(bytes);
+        }
+    }
+    bytes = nullptr;
+}
+
+bool TagArena::load(const string& filePath, uint64_t offset, string& error) {
+    return length == 0 || read(filePath, offset, error);
+}
+
+#else
+
+void TagArena::allocate(size_t size) {
+    length = size;
+    if (size == 0) {
+        return;
+    }
+    if (size >= HUGE_PAGE_SIZE) {
+        // Over-map by one huge page and trim both ends so the arena starts on a huge-page boundary
+        size_t rounded = hugePageRound(size);
+        size_t total = rounded + HUGE_PAGE_SIZE;
+        void* raw = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw != MAP_FAILED) {
+            uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+            uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) & ~(static_cast<uintptr_t>(HUGE_PAGE_SIZE) - 1);
+            if (aligned > start) {
+                munmap(raw, aligned - start);
+            }
+            if (start + total > aligned + rounded) {
+                munmap(reinterpret_cast<void*>(aligned + rounded), start + total - (aligned + rounded));
+            }
+            bytes = reinterpret_cast<char*>(aligned);
+#ifdef MADV_HUGEPAGE
+            madvise(bytes, rounded, MADV_HUGEPAGE);
+#endif
+            mapped = true;
+            return;
+        }
+    }
+    bytes = static_cast<char*>(calloc(size, 1));
+    if (bytes == nullptr) {
+        throw bad_alloc();
+    }
+}
+
+void TagArena::release() {
+    if (bytes != nullptr) {
+        if (mapped) {
+            munmap(bytes, hugePageRound(length));
+        }
+        else {
+            free(bytes);
+        }
+    }
+    bytes = nullptr;
+}
+
+bool TagArena::load(const string& filePath, uint64_t offset, string& error) {
+    if (length == 0) {
+        return true;
+    }
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if (!mapped || pageSize <= 0 || offset % pageSize != 0) {
+        return read(filePath, offset, error);
+    }
+    int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open file";
+        return false;
+    }
+    // Pages past the end of the file would fault when touched, so a short file is read instead and fails
+    size_t span = (length + pageSize - 1) / pageSize * pageSize;
+    struct stat status;
+    void* at = MAP_FAILED;
+    if (fstat(fd, &status) == 0 && static_cast<uint64_t>(status.st_size) >= offset + span) {
+        at = mmap(bytes, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, static_cast<off_t>(offset));
+    }
+    close(fd);
+    if (at != MAP_FAILED) {
+        written = true;
+        return true;
+    }
+    // A failed fixed mapping may have dropped the old one, so put fresh zero pages back before reading
+    if (mmap(bytes, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED) {
+        error = "cannot map the file";
+        return false;
+    }
+    return read(filePath, offset, error);
+}
+
+#endif
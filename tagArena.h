@@ -0,0 +1,52 @@
+#ifndef CACHE_SIMULATOR_TAGARENA_H
+#define CACHE_SIMULATOR_TAGARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// One zero-filled block holding the whole tag store of a level. Blocks of HUGE_PAGE_SIZE and up are
+// mapped straight from the OS on a huge-page boundary and, on Linux, advised for transparent huge
+// pages, so a GB-scale level needs a few hundred TLB entries instead of hundreds of thousands, and
+// pages a trace never touches are never materialized. Smaller blocks come from the heap.
+//
+// Copies are deep, except that an arena nobody asked to write to copies as a fresh zeroed one, so
+// configured levels are duplicated into hierarchies without touching their pages.
+class TagArena {
+public:
+    static const size_t HUGE_PAGE_SIZE = static_cast<size_t>(2) << 20;
+
+    TagArena() {}
+    explicit TagArena(size_t bytes);
+    TagArena(const TagArena& other);
+    TagArena(TagArena&& other) noexcept;
+    TagArena& operator=(TagArena other) noexcept;
+    ~TagArena();
+
+    const char* data() const { return bytes; }
+    char* writable() {
+        if (!written) {
+            written = true; // Only the first time, so threads writing apart from each other never race on it
+        }
+        return bytes;
+    }
+    size_t size() const { return length; }
+    bool hugePages() const { return mapped; }
+
+    // Replaces the contents with size() bytes of the file at filePath from offset on, which the file must
+    // cover up to the next multiple of the page size. A mapped arena maps those pages copy-on-write in
+    // place, so only the pages a run reaches are ever read; a heap arena reads them.
+    bool load(const std::string& filePath, uint64_t offset, std::string& error);
+
+private:
+    void allocate(size_t size);
+    void release();
+    bool read(const std::string& filePath, uint64_t offset, std::string& error);
+
+    char* bytes = nullptr;
+    size_t length = 0;
+    bool mapped = false; // Mapped from the OS on a huge-page boundary, otherwise heap memory
+    bool written = false; // writable() was called, so the contents may be other than zero
+};
+
+#endif //CACHE_SIMULATOR_TAGARENA_H
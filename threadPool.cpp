@@ -0,0 +1,86 @@
+#include "threadPool.h"
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+WorkStealingPool::WorkStealingPool(unsigned threads) {
+    if (threads == 0) {
+        threads = 1;
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        queues.push_back(unique_ptr<Queue>(new Queue()));
+    }
+}
+
+void WorkStealingPool::run(size_t count, const function<void(size_t)>& task) {
+    unsigned workers = queues.size();
+    for (unsigned worker = 0; worker < workers; worker++) {
+        size_t first = count * worker / workers;
+        size_t last = count * (worker + 1) / workers;
+        for (size_t i = first; i < last; i++) {
+            queues[worker]->tasks.push_back(i);
+        }
+    }
+
+    // The calling thread is worker 0
+    vector<thread> threads;
+    for (unsigned worker = 1; worker < workers; worker++) {
+        threads.push_back(thread(&WorkStealingPool::work, this, worker, cref(task)));
+    }
+    work(0, task);
+    for (thread& worker : threads) {
+        worker.join();
+    }
+}
+
+// Own tasks from the back, otherwise the front of the next non-empty queue. No task adds tasks, so a
+// worker that finds every queue empty is done.
+bool WorkStealingPool::take(unsigned worker, size_t& task) {
+    unsigned workers = queues.size();
+    for (unsigned i = 0; i < workers; i++) {
+        Queue& queue = *queues[(worker + i) % workers];
+        lock_guard<mutex> guard(queue.lock);
+        if (queue.tasks.empty()) {
+            continue;
+        }
+        if (i == 0) {
+            task = queue.tasks.back();
+            queue.tasks.pop_back();
+        }
+        else {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::work(unsigned worker, const function<void(size_t)>& task) {
+    size_t next;
+    while (take(worker, next)) {
+        task(next);
+    }
+}
+
+#ifdef __linux__
+
+bool pinToCore(thread& worker, unsigned core) {
+    cpu_set_t cores;
+    CPU_ZERO(&cores);
+    CPU_SET(core, &cores);
+    return pthread_setaffinity_np(worker.native_handle(), sizeof(cores), &cores) == 0;
+}
+
+#else
+
+bool pinToCore(thread&, unsigned) {
+    return false;
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef CACHE_SIMULATOR_THREADPOOL_H
+#define CACHE_SIMULATOR_THREADPOOL_H
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool for batches of independent tasks. Each worker starts with a contiguous block
+// of task indices and runs them newest first; a worker that runs dry takes the oldest task of
+// another worker, so uneven tasks (a 64-way hierarchy next to a direct-mapped one) still balance.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(unsigned threads);
+
+    unsigned threads() const { return queues.size(); }
+
+    // Runs task(i) for every i in [0, count) across the workers and returns when all are done
+    void run(size_t count, const std::function<void(size_t)>& task);
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<size_t> tasks;
+    };
+
+    bool take(unsigned worker, size_t& task);
+    void work(unsigned worker, const std::function<void(size_t)>& task);
+
+    std::vector<std::unique_ptr<Queue> > queues;
+};
+
+// Restricts worker to one core, where the platform allows it; returns whether it did
+bool pinToCore(std::thread& worker, unsigned core);
+
+#endif //CACHE_SIMULATOR_THREADPOOL_H
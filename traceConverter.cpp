@@ -0,0 +1,157 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "traceFormat.h"
+#include "traceReader.h"
+
+using namespace std;
+
+// Converts address traces between the decimal text format and the binary trace format
+
+void printUsage() {
+    cerr << "Usage:" << endl
+        << "  Trace_Converter to-binary <text trace> <binary trace> [--type data|instruction] [--bits 16-48]" << endl
+        << "  Trace_Converter to-text <binary trace> <text trace>" << endl;
+}
+
+// Smallest address width (never below the simulator's 16-bit minimum) that holds every address
+int addressBitsFor(const vector<uint64_t>& memAdds) {
+    int bits = 16;
+    for (uint64_t address : memAdds) {
+        while (bits < MAX_ADDRESS_BITS && (address >> bits) != 0) {
+            bits++;
+        }
+    }
+    return bits;
+}
+
+int toBinary(const string& inputPath, const string& outputPath, int argc, char* argv[]) {
+    TraceHeader header;
+    int bits = 0;
+    for (int i = 4; i < argc; i++) {
+        if (strcmp(argv[i], "--type") == 0 && i + 1 < argc) {
+            string type = argv[++i];
+            if (type == "data") {
+                header.type = TRACE_DATA;
+            }
+            else if (type == "instruction") {
+                header.type = TRACE_INSTRUCTION;
+            }
+            else {
+                cerr << "Unknown stream type: " << type << endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--bits") == 0 && i + 1 < argc) {
+            bits = atoi(argv[++i]);
+            if (bits < 16 || bits > MAX_ADDRESS_BITS) {
+                cerr << "Address width must be between 16 and " << MAX_ADDRESS_BITS << " bits" << endl;
+                return 1;
+            }
+        }
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    vector<uint64_t> memAdds;
+    vector<bool> writes;
+    ParseStats stats;
+    string error;
+    if (!loadTrace(inputPath, memAdds, writes, stats, error)) {
+        cerr << "Error reading file: " << inputPath << " (" << error << ")" << endl;
+        return 1;
+    }
+    if (stats.binary) {
+        cerr << inputPath << " is already a binary trace" << endl;
+        return 1;
+    }
+
+    int needed = addressBitsFor(memAdds);
+    if (bits == 0) {
+        bits = needed;
+    }
+    else if (bits < needed) {
+        cerr << "Addresses in " << inputPath << " need " << needed << " bits, more than --bits " << bits << endl;
+        return 1;
+    }
+    header.addressBits = static_cast<uint8_t>(bits);
+
+    vector<uint8_t> encoded;
+    encodeAddresses(memAdds, writes, header, encoded);
+    ofstream outputFile(outputPath, ios::binary);
+    outputFile.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+    if (!outputFile) {
+        cerr << "Error writing file: " << outputPath << endl;
+        return 1;
+    }
+
+    cout << "Wrote " << memAdds.size() << " " << traceTypeName(header.type) << " addresses ("
+        << bits << "-bit) to " << outputPath << ": " << stats.bytes << " -> " << encoded.size() << " bytes";
+    if (!encoded.empty()) {
+        cout << " (" << static_cast<double>(stats.bytes) / encoded.size() << "x smaller)";
+    }
+    cout << endl;
+    return 0;
+}
+
+int toText(const string& inputPath, const string& outputPath) {
+    vector<uint64_t> memAdds;
+    vector<bool> writes;
+    ParseStats stats;
+    string error;
+    if (!loadTrace(inputPath, memAdds, writes, stats, error)) {
+        cerr << "Error reading file: " << inputPath << " (" << error << ")" << endl;
+        return 1;
+    }
+    if (!stats.binary) {
+        cerr << inputPath << " is not a binary trace" << endl;
+        return 1;
+    }
+
+    ofstream outputFile(outputPath);
+    string line;
+    for (size_t i = 0; i < memAdds.size(); i++) {
+        if (!writes.empty()) {
+            line += writes[i] ? 'W' : 'R';
+        }
+        line += to_string(memAdds[i]);
+        // Break long traces into lines so the text stays usable in an editor
+        if (i + 1 == memAdds.size() || (i + 1) % 1024 == 0) {
+            line += '\n';
+            outputFile << line;
+            line.clear();
+        }
+        else {
+            line += ',';
+        }
+    }
+    if (!outputFile) {
+        cerr << "Error writing file: " << outputPath << endl;
+        return 1;
+    }
+
+    cout << "Wrote " << memAdds.size() << " " << traceTypeName(stats.header.type) << " addresses ("
+        << static_cast<int>(stats.header.addressBits) << "-bit) to " << outputPath << endl;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        printUsage();
+        return 1;
+    }
+    string mode = argv[1];
+    if (mode == "to-binary") {
+        return toBinary(argv[2], argv[3], argc, argv);
+    }
+    if (mode == "to-text" && argc == 4) {
+        return toText(argv[2], argv[3]);
+    }
+    printUsage();
+    return 1;
+}
@@ -0,0 +1,112 @@
+#include "traceFormat.h"
+
+#include <cstring>
+
+using namespace std;
+
+const char* traceTypeName(TraceType type) {
+    return type == TRACE_INSTRUCTION ? "instruction" : "data";
+}
+
+bool isBinaryTrace(const char* begin, const char* end) {
+    return end - begin >= 4 && memcmp(begin, TRACE_MAGIC, 4) == 0;
+}
+
+void writeHeader(const TraceHeader& header, uint8_t* out) {
+    memcpy(out, TRACE_MAGIC, 4);
+    out[4] = header.version;
+    out[5] = header.addressBits;
+    out[6] = header.type;
+    out[7] = header.flags;
+    for (int i = 0; i < 8; i++) {
+        out[8 + i] = static_cast<uint8_t>(header.count >> (8 * i));
+    }
+}
+
+bool readHeader(const char* begin, const char* end, TraceHeader& header, string& error) {
+    if (end - begin < static_cast<ptrdiff_t>(TRACE_HEADER_SIZE) || !isBinaryTrace(begin, end)) {
+        error = "missing or truncated binary trace header";
+        return false;
+    }
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(begin);
+    if (bytes[4] != TRACE_VERSION) {
+        error = "unsupported binary trace version " + to_string(bytes[4]);
+        return false;
+    }
+    if (bytes[6] != TRACE_INSTRUCTION && bytes[6] != TRACE_DATA) {
+        error = "unknown stream type " + to_string(bytes[6]);
+        return false;
+    }
+    if ((bytes[7] & ~TRACE_FLAG_WRITES) != 0) {
+        error = "unknown binary trace flags " + to_string(bytes[7]);
+        return false;
+    }
+    header.version = bytes[4];
+    header.addressBits = bytes[5];
+    header.type = static_cast<TraceType>(bytes[6]);
+    header.flags = bytes[7];
+    header.count = 0;
+    for (int i = 0; i < 8; i++) {
+        header.count |= static_cast<uint64_t>(bytes[8 + i]) << (8 * i);
+    }
+    return true;
+}
+
+bool decodeAddresses(const char* begin, const char* end, const TraceHeader& header,
+                     vector<uint64_t>& memAdds, vector<bool>& writes, string& error) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(begin);
+    const uint8_t* last = reinterpret_cast<const uint8_t*>(end);
+    bool withWrites = (header.flags & TRACE_FLAG_WRITES) != 0;
+    memAdds.reserve(memAdds.size() + header.count);
+
+    int64_t address = 0;
+    for (uint64_t i = 0; i < header.count; i++) {
+        // Fast path for the common one-byte delta
+        uint64_t value;
+        if (p < last && *p < 0x80) {
+            value = *p++;
+        }
+        else if (!readVarint(p, last, value)) {
+            error = "truncated or corrupt varint at address " + to_string(i);
+            return false;
+        }
+        if (withWrites) {
+            appendWrite(writes, memAdds.size(), (value & 1) != 0);
+            value >>= 1;
+        }
+        address += zigzagDecode(value);
+        if (address < 0 || static_cast<uint64_t>(address) > MAX_ADDRESS) {
+            error = "address out of range at address " + to_string(i);
+            return false;
+        }
+        memAdds.push_back(static_cast<uint64_t>(address));
+    }
+    if (p != last) {
+        error = "trailing bytes after " + to_string(header.count) + " addresses";
+        return false;
+    }
+    return true;
+}
+
+void encodeAddresses(const vector<uint64_t>& memAdds, const vector<bool>& writes, const TraceHeader& header,
+                     vector<uint8_t>& out) {
+    TraceHeader written = header;
+    written.count = memAdds.size();
+    written.flags = writes.empty() ? 0 : TRACE_FLAG_WRITES;
+
+    size_t start = out.size();
+    out.resize(start + TRACE_HEADER_SIZE + memAdds.size() * 10);
+    writeHeader(written, out.data() + start);
+
+    uint8_t* p = out.data() + start + TRACE_HEADER_SIZE;
+    int64_t previous = 0;
+    for (size_t i = 0; i < memAdds.size(); i++) {
+        uint64_t value = zigzagEncode(static_cast<int64_t>(memAdds[i]) - previous);
+        if (!writes.empty()) {
+            value = value << 1 | (writes[i] ? 1 : 0);
+        }
+        p += writeVarint(value, p);
+        previous = static_cast<int64_t>(memAdds[i]);
+    }
+    out.resize(p - out.data());
+}
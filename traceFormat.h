@@ -0,0 +1,107 @@
+#ifndef CACHE_SIMULATOR_TRACEFORMAT_H
+#define CACHE_SIMULATOR_TRACEFORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Binary trace layout (all integers little-endian):
+//   bytes 0-3   magic "CSTR"
+//   byte  4     format version
+//   byte  5     address width in bits (the memoryBits the trace was captured for)
+//   byte  6     stream type (TraceType)
+//   byte  7     flags (TRACE_FLAG_*)
+//   bytes 8-15  number of addresses
+// followed by one LEB128 varint per address holding the zigzag-encoded delta from the previous
+// address (the first delta is taken from address 0). Sequential traces mostly encode in one byte.
+// With TRACE_FLAG_WRITES the varint holds the zigzag delta shifted left once, and the low bit is set
+// for a write.
+
+const char TRACE_MAGIC[4] = {'C', 'S', 'T', 'R'};
+const uint8_t TRACE_VERSION = 1;
+const size_t TRACE_HEADER_SIZE = 16;
+const uint8_t TRACE_FLAG_WRITES = 1; // Every address carries a read/write bit
+
+// Widest address space simulated, that of x86-64 and AArch64 virtual addresses; addresses are carried as
+// uint64_t from the parser to the tag lookup, and anything wider is rejected as out of range
+const int MAX_ADDRESS_BITS = 48;
+const uint64_t MAX_ADDRESS = (1ULL << MAX_ADDRESS_BITS) - 1;
+
+enum TraceType : uint8_t {
+    TRACE_INSTRUCTION = 0,
+    TRACE_DATA = 1
+};
+
+struct TraceHeader {
+    uint8_t version = TRACE_VERSION;
+    uint8_t addressBits = 32;
+    TraceType type = TRACE_DATA;
+    uint8_t flags = 0;
+    uint64_t count = 0;
+};
+
+const char* traceTypeName(TraceType type);
+
+// True when the bytes start with a binary trace header
+bool isBinaryTrace(const char* begin, const char* end);
+
+// Header serialization, readHeader fails on a bad magic, version or truncated header
+void writeHeader(const TraceHeader& header, uint8_t* out);
+bool readHeader(const char* begin, const char* end, TraceHeader& header, std::string& error);
+
+// Zigzag keeps small negative deltas (backward jumps) as small as small positive ones
+inline uint64_t zigzagEncode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t zigzagDecode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Writes value as a LEB128 varint and returns the number of bytes used (at most 10)
+inline size_t writeVarint(uint64_t value, uint8_t* out) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = static_cast<uint8_t>(value);
+    return n;
+}
+
+// Reads one LEB128 varint, advancing p; false when the input ends inside it or it exceeds 64 bits
+inline bool readVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t byte = *p++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Write flags run parallel to an address list. An empty list means every access is a read, so read-only
+// traces never pay for them; once a trace has a write, the list holds one flag per address.
+inline void appendWrite(std::vector<bool>& writes, size_t index, bool write) {
+    if (write && writes.size() < index) {
+        writes.resize(index, false);
+    }
+    if (write || !writes.empty()) {
+        writes.push_back(write);
+    }
+}
+
+// Decodes the payload of a binary trace into memAdds and writes; fails on truncation or addresses
+// beyond MAX_ADDRESS
+bool decodeAddresses(const char* begin, const char* end, const TraceHeader& header,
+                     std::vector<uint64_t>& memAdds, std::vector<bool>& writes, std::string& error);
+
+// Encodes a whole address list as a binary trace (header included), with read/write bits when writes
+// is not empty
+void encodeAddresses(const std::vector<uint64_t>& memAdds, const std::vector<bool>& writes, const TraceHeader& header,
+                     std::vector<uint8_t>& out);
+
+#endif //CACHE_SIMULATOR_TRACEFORMAT_H
@@ -0,0 +1,311 @@
+#include "traceReader.h"
+
+#include <chrono>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const string& filePath) {
+    HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return;
+    }
+    fileHandle = file;
+    opened = true;
+    length = static_cast<size_t>(fileSize.QuadPart);
+    if (length == 0) {
+        return; // Nothing to map, an empty trace is still a valid trace
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        opened = false;
+        return;
+    }
+    mappingHandle = mapping;
+    bytes = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (bytes == nullptr) {
+        opened = false;
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (bytes != nullptr) {
+        UnmapViewOfFile(bytes);
+    }
+    if (mappingHandle != nullptr) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle != nullptr) {
+        CloseHandle(fileHandle);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const string& filePath) {
+    int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat fileInfo;
+    if (fstat(fd, &fileInfo) != 0) {
+        close(fd);
+        return;
+    }
+    length = static_cast<size_t>(fileInfo.st_size);
+    if (length == 0) {
+        close(fd);
+        opened = true; // Nothing to map, an empty trace is still a valid trace
+        return;
+    }
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps its own reference to the file
+    if (mapped == MAP_FAILED) {
+        length = 0;
+        return;
+    }
+    // The parser walks the bytes front to back exactly once
+    madvise(mapped, length, MADV_SEQUENTIAL);
+    bytes = static_cast<const char*>(mapped);
+    opened = true;
+}
+
+MappedFile::~MappedFile() {
+    if (bytes != nullptr) {
+        munmap(const_cast<char*>(bytes), length);
+    }
+}
+
+#endif
+
+bool parseAddresses(const char* begin, const char* end, vector<uint64_t>& memAdds, vector<bool>& writes,
+                    string& error, size_t offset) {
+    const char* p = begin;
+    bool write = false; // Operation prefix of the next address
+    bool prefixed = false;
+    while (p < end) {
+        unsigned char c = static_cast<unsigned char>(*p);
+        unsigned digit = c - '0';
+        if (digit <= 9) {
+            // Accumulate in 64 bits so an overflowing token can be reported instead of wrapping
+            uint64_t value = digit;
+            ++p;
+            while (p < end && (digit = static_cast<unsigned char>(*p) - '0') <= 9) {
+                value = value * 10 + digit;
+                if (value > MAX_ADDRESS) {
+                    error = "address out of range at byte " + to_string(offset + (p - begin));
+                    return false;
+                }
+                ++p;
+            }
+            if (write || !writes.empty()) {
+                appendWrite(writes, memAdds.size(), write);
+            }
+            memAdds.push_back(value);
+            write = false;
+            prefixed = false;
+        }
+        else if (!prefixed && (c == ',' || c == '\n' || c == '\r' || c == ' ' || c == '\t')) {
+            ++p; // Separators, blank lines and padding between addresses
+        }
+        else if (!prefixed && (c == 'R' || c == 'r' || c == 'W' || c == 'w')) {
+            write = c == 'W' || c == 'w';
+            prefixed = true;
+            ++p;
+        }
+        else {
+            error = string("unexpected character '") + static_cast<char>(c) + "' at byte " + to_string(offset + (p - begin));
+            return false;
+        }
+    }
+    if (prefixed) {
+        error = "operation without an address at the end of the trace";
+        return false;
+    }
+    return true;
+}
+
+bool loadTrace(const string& filePath, vector<uint64_t>& memAdds, vector<bool>& writes, ParseStats& stats,
+               string& error) {
+    auto start = chrono::steady_clock::now();
+
+    MappedFile file(filePath);
+    if (!file.isOpen()) {
+        error = "cannot open or map file";
+        return false;
+    }
+
+    size_t before = memAdds.size();
+    const char* begin = file.data();
+    const char* end = begin + file.size();
+
+    stats.binary = isBinaryTrace(begin, end);
+    if (stats.binary) {
+        if (!readHeader(begin, end, stats.header, error) ||
+            !decodeAddresses(begin + TRACE_HEADER_SIZE, end, stats.header, memAdds, writes, error)) {
+            return false;
+        }
+    }
+    else {
+        // Roughly one slot per short address plus its separator, so most traces never regrow
+        memAdds.reserve(before + file.size() / 4);
+        if (!parseAddresses(begin, end, memAdds, writes, error)) {
+            return false;
+        }
+    }
+
+    stats.addresses = memAdds.size() - before;
+    stats.bytes = file.size();
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+bool TraceStream::open(const string& filePath, string& error) {
+    if (filePath == "-") {
+        input = cin.rdbuf();
+    }
+    else {
+        file.open(filePath, ios::binary);
+        if (!file) {
+            error = "cannot open file";
+            return false;
+        }
+        input = file.rdbuf();
+    }
+    buffer.resize(BUFFER_SIZE);
+
+    // The header decides how the rest of the stream is parsed. Whitespace in front of it is skipped,
+    // a trace piped after the interactive answers starts with the newline that ended the last answer.
+    refill();
+    while (position < length && isspace(static_cast<unsigned char>(buffer[position]))) {
+        position++;
+    }
+    refill();
+    binary = isBinaryTrace(buffer.data(), buffer.data() + length);
+    if (binary) {
+        if (!readHeader(buffer.data(), buffer.data() + length, binaryHeader, error)) {
+            return false;
+        }
+        position += TRACE_HEADER_SIZE;
+        remaining = binaryHeader.count;
+    }
+    return true;
+}
+
+// Moves the unconsumed tail to the front of the buffer and tops it up from the input
+void TraceStream::refill() {
+    if (position > 0) {
+        memmove(buffer.data(), buffer.data() + position, length - position);
+        consumed += position;
+        length -= position;
+        position = 0;
+    }
+    while (!endOfInput && length < buffer.size()) {
+        streamsize got = input->sgetn(buffer.data() + length, buffer.size() - length);
+        if (got <= 0) {
+            endOfInput = true;
+        }
+        else {
+            length += static_cast<size_t>(got);
+        }
+    }
+}
+
+bool TraceStream::next(vector<uint64_t>& chunk, vector<bool>& writes) {
+    chunk.clear();
+    writes.clear();
+    // A buffer holding only separators yields no addresses, so keep reading until some show up
+    while (chunk.empty() && !failed()) {
+        refill();
+        if (position == length) {
+            if (binary && remaining > 0) {
+                errorMessage = "trace ends after " + to_string(binaryHeader.count - remaining) + " of " +
+                    to_string(binaryHeader.count) + " addresses";
+            }
+            return false;
+        }
+        if (binary) {
+            nextBinary(chunk, writes);
+        }
+        else {
+            nextText(chunk, writes);
+        }
+        if (binary && remaining == 0) {
+            break;
+        }
+    }
+    return !chunk.empty();
+}
+
+void TraceStream::nextText(vector<uint64_t>& chunk, vector<bool>& writes) {
+    const char* begin = buffer.data() + position;
+    const char* end = buffer.data() + length;
+
+    // Only parse up to the last separator so a number split across two reads stays whole, along with
+    // its operation prefix
+    const char* safe = end;
+    if (!endOfInput) {
+        while (safe > begin && static_cast<unsigned>(safe[-1] - '0') <= 9) {
+            --safe;
+        }
+        if (safe > begin && (safe[-1] == 'R' || safe[-1] == 'r' || safe[-1] == 'W' || safe[-1] == 'w')) {
+            --safe;
+        }
+        if (safe == begin) {
+            errorMessage = "token longer than the read buffer at byte " + to_string(consumed + position);
+            return;
+        }
+    }
+    if (parseAddresses(begin, safe, chunk, writes, errorMessage, consumed + position)) {
+        position = safe - buffer.data();
+    }
+}
+
+void TraceStream::nextBinary(vector<uint64_t>& chunk, vector<bool>& writes) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(buffer.data() + position);
+    const uint8_t* last = reinterpret_cast<const uint8_t*>(buffer.data() + length);
+
+    // Only decode varints that cannot be cut off by the end of the buffer (a varint is at most 10 bytes)
+    const uint8_t* safe = last;
+    if (!endOfInput) {
+        safe = last - p > 10 ? last - 10 : p;
+    }
+    while (remaining > 0 && p < safe) {
+        uint64_t value;
+        if (!readVarint(p, last, value)) {
+            errorMessage = "truncated or corrupt varint at address " + to_string(binaryHeader.count - remaining);
+            return;
+        }
+        if ((binaryHeader.flags & TRACE_FLAG_WRITES) != 0) {
+            appendWrite(writes, chunk.size(), (value & 1) != 0);
+            value >>= 1;
+        }
+        lastAddress += zigzagDecode(value);
+        if (lastAddress < 0 || static_cast<uint64_t>(lastAddress) > MAX_ADDRESS) {
+            errorMessage = "address out of range at address " + to_string(binaryHeader.count - remaining);
+            return;
+        }
+        chunk.push_back(static_cast<uint64_t>(lastAddress));
+        remaining--;
+    }
+    position = reinterpret_cast<const char*>(p) - buffer.data();
+}
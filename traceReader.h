@@ -0,0 +1,92 @@
+#ifndef CACHE_SIMULATOR_TRACEREADER_H
+#define CACHE_SIMULATOR_TRACEREADER_H
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "traceFormat.h"
+
+// Read-only view of a whole file mapped into the address space
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filePath);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const { return opened; }
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    bool opened = false;
+    const char* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+// Throughput figures of one trace load
+struct ParseStats {
+    size_t addresses = 0; // Number of addresses parsed
+    size_t bytes = 0; // Size of the trace file
+    double seconds = 0; // Wall time spent mapping and parsing
+    bool binary = false; // Whether the file was a binary trace
+    TraceHeader header; // Header of a binary trace, untouched for text traces
+};
+
+// Parses comma/newline separated decimal addresses directly from a byte range. An address may be
+// prefixed with R (read, the default) or W (write), as in W4096; write flags go to writes (see appendWrite).
+// Returns false and fills error on a malformed or out of range token; offset is the position of
+// begin within the whole trace and only shifts the byte positions reported in errors.
+bool parseAddresses(const char* begin, const char* end, std::vector<uint64_t>& memAdds, std::vector<bool>& writes,
+                    std::string& error, size_t offset = 0);
+
+// Maps a trace file (text or binary, detected from its header) and appends every address in it to memAdds,
+// and its write flags to writes
+bool loadTrace(const std::string& filePath, std::vector<uint64_t>& memAdds, std::vector<bool>& writes,
+               ParseStats& stats, std::string& error);
+
+// Bounded-memory reader that hands out a text or binary trace in chunks, so a trace of any length
+// is simulated with a fixed read buffer and a fixed-size chunk of addresses
+class TraceStream {
+public:
+    static const size_t BUFFER_SIZE = 1 << 20;
+
+    // Opens a trace file, "-" reads the trace from standard input (after anything cin already consumed)
+    bool open(const std::string& filePath, std::string& error);
+
+    // Replaces chunk with the next addresses of the trace and writes with their write flags (empty when
+    // they are all reads); false once the trace is exhausted or on error
+    bool next(std::vector<uint64_t>& chunk, std::vector<bool>& writes);
+
+    bool failed() const { return !errorMessage.empty(); }
+    const std::string& error() const { return errorMessage; }
+    bool isBinary() const { return binary; }
+    const TraceHeader& header() const { return binaryHeader; }
+
+private:
+    void refill();
+    void nextText(std::vector<uint64_t>& chunk, std::vector<bool>& writes);
+    void nextBinary(std::vector<uint64_t>& chunk, std::vector<bool>& writes);
+
+    std::ifstream file;
+    std::streambuf* input = nullptr;
+    std::vector<char> buffer;
+    size_t position = 0; // First unconsumed byte in buffer
+    size_t length = 0; // Bytes currently held in buffer
+    size_t consumed = 0; // Trace bytes dropped from the front of buffer so far
+    bool endOfInput = false;
+    std::string errorMessage;
+
+    bool binary = false;
+    TraceHeader binaryHeader;
+    uint64_t remaining = 0; // Addresses still to decode from a binary trace
+    int64_t lastAddress = 0; // Base of the next binary delta
+};
+
+#endif //CACHE_SIMULATOR_TRACEREADER_H
@@ -0,0 +1,98 @@
+#ifndef CACHE_SIMULATOR_TRACEWRITER_H
+#define CACHE_SIMULATOR_TRACEWRITER_H
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Buffered writer for the per-access trace. Rows are formatted straight into a large buffer that is
+// written out in big blocks, never flushed per line. It writes through stdio, so text already sent
+// to cout (synced with stdio) stays in order as long as flush() runs before cout is used again.
+class TraceWriter {
+public:
+    explicit TraceWriter(FILE* out = stdout, size_t capacity = 1 << 22) : out(out), buffer(capacity) {}
+    ~TraceWriter() { flush(); }
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    // Left-aligned and space padded to width, like cout << left << setw(width)
+    TraceWriter& field(long long value, int width) {
+        char digits[24];
+        int length = format(value, digits);
+        return pad(digits, length, width);
+    }
+
+    TraceWriter& field(const char* value, int width) {
+        return pad(value, static_cast<int>(strlen(value)), width);
+    }
+
+    TraceWriter& field(const std::string& value, int width) {
+        return pad(value.data(), static_cast<int>(value.size()), width);
+    }
+
+    TraceWriter& text(const char* value) {
+        return pad(value, static_cast<int>(strlen(value)), 0);
+    }
+
+    TraceWriter& number(long long value) {
+        return field(value, 0);
+    }
+
+    TraceWriter& newline() {
+        reserve(1);
+        buffer[used++] = '\n';
+        return *this;
+    }
+
+    void flush() {
+        if (used > 0) {
+            fwrite(buffer.data(), 1, used, out);
+            used = 0;
+        }
+    }
+
+private:
+    void reserve(size_t bytes) {
+        if (used + bytes > buffer.size()) {
+            flush();
+            if (bytes > buffer.size()) {
+                buffer.resize(bytes);
+            }
+        }
+    }
+
+    TraceWriter& pad(const char* value, int length, int width) {
+        int total = length < width ? width : length;
+        reserve(total);
+        memcpy(buffer.data() + used, value, length);
+        memset(buffer.data() + used + length, ' ', total - length);
+        used += total;
+        return *this;
+    }
+
+    static int format(long long value, char* digits) {
+        char reversed[24];
+        int count = 0;
+        unsigned long long magnitude = value < 0 ? 0ULL - static_cast<unsigned long long>(value) : value;
+        do {
+            reversed[count++] = static_cast<char>('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude != 0);
+        int length = 0;
+        if (value < 0) {
+            digits[length++] = '-';
+        }
+        while (count > 0) {
+            digits[length++] = reversed[--count];
+        }
+        return length;
+    }
+
+    FILE* out;
+    std::vector<char> buffer;
+    size_t used = 0;
+};
+
+#endif //CACHE_SIMULATOR_TRACEWRITER_H
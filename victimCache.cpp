@@ -0,0 +1,71 @@
+#include "victimCache.h"
+
+using namespace std;
+
+bool VictimCache::take(int64_t line, bool& dirty) {
+    probes++;
+    int entry = lookup(line);
+    if (entry < 0) {
+        return false;
+    }
+    hits++;
+    dirty = lines[entry].dirty;
+    if (kind == VICTIM_CACHE) {
+        lines.erase(lines.begin() + entry);
+    }
+    else {
+        lines[entry].lastUse = ++useClock;
+    }
+    return true;
+}
+
+bool VictimCache::insert(int64_t line, bool dirty, int64_t& pushedLine, bool& pushedDirty) {
+    int entry = lookup(line);
+    if (entry >= 0) {
+        lines[entry].dirty = lines[entry].dirty || dirty;
+        lines[entry].lastUse = ++useClock;
+        return false;
+    }
+    bool pushed = false;
+    if (static_cast<int>(lines.size()) == entries) {
+        int oldest = 0;
+        for (int i = 1; i < entries; i++) {
+            if (lines[i].lastUse < lines[oldest].lastUse) {
+                oldest = i;
+            }
+        }
+        pushedLine = lines[oldest].line;
+        pushedDirty = lines[oldest].dirty;
+        lines.erase(lines.begin() + oldest);
+        pushed = true;
+    }
+    Entry added = {line, dirty, ++useClock};
+    lines.push_back(added);
+    return pushed;
+}
+
+bool VictimCache::invalidate(int64_t line) {
+    int entry = lookup(line);
+    if (entry < 0) {
+        return false;
+    }
+    bool wasDirty = lines[entry].dirty;
+    lines.erase(lines.begin() + entry);
+    return wasDirty;
+}
+
+string VictimCache::describe() const {
+    if (kind == VICTIM_NONE) {
+        return victimCacheName(kind);
+    }
+    return string(victimCacheName(kind)) + ":" + to_string(entries);
+}
+
+int VictimCache::lookup(int64_t line) const {
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (lines[i].line == line) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
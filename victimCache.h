@@ -0,0 +1,80 @@
+#ifndef CACHE_SIMULATOR_VICTIMCACHE_H
+#define CACHE_SIMULATOR_VICTIMCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Small fully-associative LRU buffers beside a cache level, probed alongside it so a hit costs the
+// level's own access time (Jouppi):
+//   victim  holds the lines the level evicts; a hit swaps the line back into the level
+//   miss    holds copies of the lines the level fetched on misses; a hit copies the line back in
+// Both mostly save the conflict misses of direct-mapped levels.
+enum VictimCacheKind {
+    VICTIM_NONE,
+    VICTIM_CACHE,
+    MISS_CACHE
+};
+
+inline const char* victimCacheName(VictimCacheKind kind) {
+    switch (kind) {
+        case VICTIM_NONE: return "none";
+        case VICTIM_CACHE: return "victim";
+        case MISS_CACHE: return "miss";
+    }
+    return "?";
+}
+
+// Accepts the names printed by victimCacheName()
+inline bool parseVictimCache(const std::string& name, VictimCacheKind& kind) {
+    for (int i = VICTIM_NONE; i <= MISS_CACHE; i++) {
+        if (name == victimCacheName(static_cast<VictimCacheKind>(i))) {
+            kind = static_cast<VictimCacheKind>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const int MAX_VICTIM_ENTRIES = 64;
+
+// One level's victim or miss cache. Lines are numbered in the level's lines (address / line size).
+class VictimCache {
+public:
+    VictimCache() {}
+    VictimCache(VictimCacheKind kind, int entries) : kind(kind), entries(entries) {}
+
+    VictimCacheKind kind = VICTIM_NONE;
+    int entries = 0;
+
+    uint64_t probes = 0; // Misses of the level that looked here
+    uint64_t hits = 0;
+
+    // Probe on a miss of the level: true when line is here. A victim cache gives the line up with its
+    // dirty bit, a miss cache keeps its (clean) copy.
+    bool take(int64_t line, bool& dirty);
+
+    // Adds line as the most recently used entry, or refreshes it if already here. Returns true with the
+    // least recently used entry when that had to make room.
+    bool insert(int64_t line, bool dirty, int64_t& pushedLine, bool& pushedDirty);
+
+    // Drops line if it is here and returns whether it was dirty
+    bool invalidate(int64_t line);
+
+    // "victim:4", or "none"
+    std::string describe() const;
+
+private:
+    struct Entry {
+        int64_t line;
+        bool dirty;
+        uint64_t lastUse;
+    };
+
+    int lookup(int64_t line) const;
+
+    std::vector<Entry> lines;
+    uint64_t useClock = 0;
+};
+
+#endif //CACHE_SIMULATOR_VICTIMCACHE_H